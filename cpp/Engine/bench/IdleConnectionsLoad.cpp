@@ -0,0 +1,183 @@
+// Opens many TCP connections to a running engine that each send one tagged and one
+// untagged request and then go quiet, and reports how much the engine's resident set
+// grew per connection. With a hold time it then waits for the engine's idle timeout to
+// close them and reports when it did.
+//
+// usage: ds_idle_connections_load <port> <connections> <engine pid> [hold seconds]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace
+{
+constexpr std::string_view kRequests = "@1 0.1 0.2 0.3 0.4 0.5 0.6 0.7 0.8\n0.1 0.2 0.3 0.4 0.5 0.6 0.7 0.8\n";
+constexpr int kRepliesPerConnection = 2;
+
+long resident_kib(pid_t pid)
+{
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmRSS:", 0) == 0)
+        {
+            return std::stol(line.substr(6));
+        }
+    }
+    throw std::runtime_error("No VmRSS for pid " + std::to_string(pid));
+}
+
+void raise_descriptor_limit()
+{
+    rlimit limit{};
+    if (::getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int connect_and_send(std::uint16_t port)
+{
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        throw std::runtime_error(std::string("socket failed: ") + std::strerror(errno));
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::send(fd, kRequests.data(), kRequests.size(), 0) != static_cast<ssize_t>(kRequests.size()))
+    {
+        const std::string reason = std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("connect/send failed: " + reason);
+    }
+    return fd;
+}
+
+void await_replies(int fd)
+{
+    int lines = 0;
+    char buffer[256];
+    while (lines < kRepliesPerConnection)
+    {
+        const ssize_t received = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0)
+        {
+            throw std::runtime_error("Connection closed before its replies arrived");
+        }
+        for (ssize_t i = 0; i < received; ++i)
+        {
+            lines += buffer[i] == '\n' ? 1 : 0;
+        }
+    }
+}
+
+// Waits until the engine has closed every connection or `hold` runs out; returns how
+// many are still open.
+std::size_t await_idle_close(const std::vector<int> &fds, std::chrono::seconds hold)
+{
+    std::vector<pollfd> open;
+    open.reserve(fds.size());
+    for (const int fd : fds)
+    {
+        open.push_back(pollfd{.fd = fd, .events = POLLIN, .revents = 0});
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + hold;
+    while (!open.empty() && std::chrono::steady_clock::now() < deadline)
+    {
+        if (::poll(open.data(), open.size(), 500) < 0 && errno != EINTR)
+        {
+            throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+        }
+
+        std::erase_if(open, [](const pollfd &entry) {
+            char byte = 0;
+            return (entry.revents & (POLLIN | POLLHUP | POLLERR)) != 0 &&
+                   ::recv(entry.fd, &byte, 1, MSG_DONTWAIT) <= 0;
+        });
+    }
+    return open.size();
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        std::fprintf(stderr, "usage: %s <port> <connections> <engine pid> [hold seconds]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        const auto port = static_cast<std::uint16_t>(std::stoi(argv[1]));
+        const std::size_t connections = std::stoul(argv[2]);
+        const auto engine_pid = static_cast<pid_t>(std::stoi(argv[3]));
+        const std::chrono::seconds hold(argc > 4 ? std::stoi(argv[4]) : 0);
+
+        raise_descriptor_limit();
+        const long before_kib = resident_kib(engine_pid);
+
+        std::vector<int> fds;
+        fds.reserve(connections);
+        for (std::size_t i = 0; i < connections; ++i)
+        {
+            fds.push_back(connect_and_send(port));
+        }
+        for (const int fd : fds)
+        {
+            await_replies(fd);
+        }
+
+        // Let the engine settle after the last replies before sampling it again.
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        const long after_kib = resident_kib(engine_pid);
+        std::printf("connections=%zu rss_before=%ld KiB rss_after=%ld KiB per_connection=%.0f bytes\n",
+                    connections,
+                    before_kib,
+                    after_kib,
+                    static_cast<double>(after_kib - before_kib) * 1024.0 / static_cast<double>(connections));
+
+        if (hold.count() > 0)
+        {
+            const auto started = std::chrono::steady_clock::now();
+            const std::size_t still_open = await_idle_close(fds, hold);
+            const std::chrono::duration<double> waited = std::chrono::steady_clock::now() - started;
+            std::printf("closed by engine after %.1f s, still open=%zu\n", waited.count(), still_open);
+        }
+
+        for (const int fd : fds)
+        {
+            ::close(fd);
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        std::fprintf(stderr, "Fatal error: %s\n", ex.what());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
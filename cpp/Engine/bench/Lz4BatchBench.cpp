@@ -0,0 +1,322 @@
+// Compares raw and LZ4-compressed binary batch frames: bytes on the wire per row in
+// each direction, what packing a frame costs the producer and what unpacking it and
+// writing the batch reply costs the engine. Scoring is left out; it is the same for
+// both. "Repetitive" rows repeat 32 distinct readings in runs of 1 to 16 rows, like a
+// historian backfill; "random" rows are independent "%.3f" values.
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "Lz4Block.hpp"
+#include "ReplyBuffer.hpp"
+#include "WireProtocol.hpp"
+
+namespace
+{
+using ds::wire::Encoding;
+
+constexpr std::size_t kInputSize = 8;
+constexpr std::size_t kRows = 1024;
+constexpr std::size_t kPatterns = 32;
+constexpr std::size_t kMaxRun = 16;
+
+float round_to_milli(float value)
+{
+    return std::round(value * 1000.0F) / 1000.0F;
+}
+
+std::vector<float> repetitive_rows(std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> reading(-1.0F, 1.0F);
+    std::vector<std::vector<float>> patterns(kPatterns, std::vector<float>(kInputSize));
+    for (std::vector<float> &pattern : patterns)
+    {
+        std::generate(pattern.begin(), pattern.end(), [&] { return round_to_milli(reading(rng)); });
+    }
+
+    std::vector<float> rows;
+    while (rows.size() < kRows * kInputSize)
+    {
+        const std::vector<float> &pattern = patterns[rng() % kPatterns];
+        for (std::size_t run = 1 + rng() % kMaxRun; run > 0; --run)
+        {
+            rows.insert(rows.end(), pattern.begin(), pattern.end());
+        }
+    }
+    rows.resize(kRows * kInputSize);
+    return rows;
+}
+
+std::vector<float> random_rows(std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> reading(-1.0F, 1.0F);
+    std::vector<float> rows(kRows * kInputSize);
+    std::generate(rows.begin(), rows.end(), [&] { return round_to_milli(reading(rng)); });
+    return rows;
+}
+
+std::uint16_t float_to_half(float value)
+{
+    // Finite values below 65504 only; rounds to nearest even like the producer.
+    const std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+    const std::uint32_t sign = (bits >> 16) & 0x8000u;
+    if ((bits & 0x7fffffffu) < 0x38800000u)
+    {
+        return static_cast<std::uint16_t>(sign | static_cast<std::uint32_t>(std::lround(std::fabs(value) * 0x1p24F)));
+    }
+    const std::uint32_t rebiased = (bits & 0x7fffffffu) - ((127u - 15u) << 23);
+    const std::uint32_t rounded = rebiased + 0xfffu + ((rebiased >> 13) & 1u);
+    return static_cast<std::uint16_t>(sign | (rounded >> 13));
+}
+
+// Writes `rows` into a batch body the way the producer does: a float32 scale first for
+// the scaled integer encodings, then every value. Assumes a little-endian host.
+void pack_body(Encoding encoding, std::span<const float> rows, std::vector<char> &body)
+{
+    float scale = 1.0F;
+    if (ds::wire::scaled_encoding(encoding))
+    {
+        float peak = 0.0F;
+        for (const float value : rows)
+        {
+            peak = std::max(peak, std::fabs(value));
+        }
+        const float limit = (encoding == Encoding::Int16) ? 32767.0F : 127.0F;
+        scale = (peak > 0.0F) ? peak / limit : 1.0F;
+    }
+
+    body.resize(ds::wire::batch_body_size(encoding, rows.size() / kInputSize, kInputSize));
+    char *out = body.data();
+    if (ds::wire::scaled_encoding(encoding))
+    {
+        std::memcpy(out, &scale, sizeof(scale));
+        out += sizeof(scale);
+    }
+
+    for (const float value : rows)
+    {
+        switch (encoding)
+        {
+        case Encoding::Float32:
+            std::memcpy(out, &value, sizeof(value));
+            break;
+        case Encoding::Float16:
+        {
+            const std::uint16_t half = float_to_half(value);
+            std::memcpy(out, &half, sizeof(half));
+            break;
+        }
+        case Encoding::Int16:
+        {
+            const auto integer = static_cast<std::int16_t>(std::lround(value / scale));
+            std::memcpy(out, &integer, sizeof(integer));
+            break;
+        }
+        case Encoding::Int8:
+            *out = static_cast<char>(static_cast<std::int8_t>(std::lround(value / scale)));
+            break;
+        }
+        out += ds::wire::encoded_value_size(encoding);
+    }
+}
+
+struct Frame
+{
+    ds::wire::FrameHeader header;
+    std::vector<char> raw;
+    std::vector<char> wire;
+};
+
+// Producer side: packs `rows` and, for compressed frames, compresses the body.
+void encode_frame(Encoding encoding, bool compressed, std::span<const float> rows, Frame &frame)
+{
+    pack_body(encoding, rows, frame.raw);
+    if (!compressed)
+    {
+        frame.wire = frame.raw;
+        return;
+    }
+
+    const std::string_view raw(frame.raw.data(), frame.raw.size());
+    frame.wire.resize(ds::lz4::compress_bound(raw.size()));
+    frame.wire.resize(ds::lz4::compress(raw, frame.wire));
+}
+
+struct EngineScratch
+{
+    std::vector<float> inputs;
+    std::vector<char> packed;
+    std::vector<ds::DetectionResult> results;
+    ds::ReplyBuffer replies;
+};
+
+// Engine side, as SessionProtocol::score_batch_frame does it minus the scoring: the
+// body is decompressed (float32 straight into the inputs), widened to float32 and
+// answered with a batch reply. Returns the reply size.
+std::size_t decode_frame(const Frame &frame, EngineScratch &scratch)
+{
+    const ds::wire::FrameHeader &header = frame.header;
+    const std::size_t raw_size = frame.raw.size();
+    std::string_view body(frame.wire.data(), frame.wire.size());
+
+    scratch.inputs.resize(header.count * kInputSize);
+    const std::span<float> inputs(scratch.inputs);
+    if (header.compressed())
+    {
+        if (header.encoding == Encoding::Float32 && std::endian::native == std::endian::little)
+        {
+            if (!ds::lz4::decompress(body, std::span<char>(reinterpret_cast<char *>(inputs.data()), raw_size)))
+            {
+                throw std::runtime_error("Malformed compressed batch body");
+            }
+            body = {};
+        }
+        else
+        {
+            scratch.packed.resize(raw_size);
+            if (!ds::lz4::decompress(body, scratch.packed))
+            {
+                throw std::runtime_error("Malformed compressed batch body");
+            }
+            body = std::string_view(scratch.packed.data(), raw_size);
+        }
+    }
+
+    if (!body.empty())
+    {
+        ds::wire::decode_frame_values(header, body.data(), inputs);
+    }
+
+    ds::wire::append_batch_reply(scratch.replies, scratch.results, header.compressed());
+    const std::size_t reply_size = scratch.replies.size();
+    scratch.replies.consume(reply_size);
+    return reply_size;
+}
+
+// Reply rows as a stub detector would score the decoded inputs: the mean square of
+// the row as the MSE and one row in ten an anomaly.
+std::vector<ds::DetectionResult> stub_results(std::span<const float> rows)
+{
+    std::vector<ds::DetectionResult> results(rows.size() / kInputSize);
+    for (std::size_t row = 0; row < results.size(); ++row)
+    {
+        double sum = 0.0;
+        for (const float value : rows.subspan(row * kInputSize, kInputSize))
+        {
+            sum += static_cast<double>(value) * value;
+        }
+        results[row].mse = sum / kInputSize;
+        results[row].status = (row % 10 == 9) ? ds::DetectionStatus::Anomaly : ds::DetectionStatus::Ok;
+    }
+    return results;
+}
+
+template <typename Run>
+double nanoseconds_per_row(int rounds, Run &&run)
+{
+    const auto started = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round)
+    {
+        run();
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - started;
+    return elapsed.count() / (static_cast<double>(rounds) * static_cast<double>(kRows));
+}
+
+const char *encoding_name(Encoding encoding)
+{
+    switch (encoding)
+    {
+    case Encoding::Float32:
+        return "float32";
+    case Encoding::Float16:
+        return "float16";
+    case Encoding::Int16:
+        return "int16";
+    case Encoding::Int8:
+        return "int8";
+    }
+    return "unknown";
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const int rounds = argc > 1 ? std::atoi(argv[1]) : 2000;
+    std::mt19937 rng(42);
+
+    struct Dataset
+    {
+        const char *name;
+        std::vector<float> rows;
+    };
+    const Dataset datasets[] = {{"repetitive", repetitive_rows(rng)}, {"random", random_rows(rng)}};
+
+    std::printf("%zu-row frames of %zu values x %d rounds\n", kRows, kInputSize, rounds);
+    std::printf("data        enc      mode  up B/row  down B/row  producer ns/row  engine ns/row\n");
+    if (!ds::lz4::available())
+    {
+        std::printf("(built without DS_ENABLE_LZ4; only raw frames are measured)\n");
+    }
+
+    volatile float sink = 0.0F;
+    for (const Dataset &dataset : datasets)
+    {
+        for (const Encoding encoding : {Encoding::Float32, Encoding::Float16, Encoding::Int16, Encoding::Int8})
+        {
+            for (const bool compressed : {false, true})
+            {
+                if (compressed && !ds::lz4::available())
+                {
+                    continue;
+                }
+
+                Frame frame;
+                frame.header = ds::wire::FrameHeader{
+                    .type = ds::wire::FrameType::EvaluateBatch,
+                    .encoding = encoding,
+                    .flags = compressed ? ds::wire::kFlagCompressed : std::uint16_t{0},
+                    .count = static_cast<std::uint32_t>(kRows),
+                };
+                EngineScratch scratch;
+                scratch.results = stub_results(dataset.rows);
+
+                const double producer_ns =
+                    nanoseconds_per_row(rounds, [&] { encode_frame(encoding, compressed, dataset.rows, frame); });
+
+                std::size_t reply_size = 0;
+                const double engine_ns = nanoseconds_per_row(rounds, [&] {
+                    reply_size = decode_frame(frame, scratch);
+                    sink = sink + scratch.inputs[0];
+                });
+
+                // Compressed frames must decode to the same floats as raw ones.
+                std::vector<float> expected(dataset.rows.size());
+                ds::wire::decode_frame_values(frame.header, frame.raw.data(), expected);
+                if (scratch.inputs != expected)
+                {
+                    std::fprintf(stderr, "%s %s frame did not round-trip\n", dataset.name, encoding_name(encoding));
+                    return EXIT_FAILURE;
+                }
+
+                const double up = static_cast<double>(ds::wire::kFrameHeaderSize + ds::wire::kBodySizeSize +
+                                                      frame.wire.size()) /
+                                  kRows;
+                const double down = static_cast<double>(reply_size) / kRows;
+                std::printf("%-10s  %-7s  %-4s  %8.2f  %10.2f  %15.1f  %13.1f\n", dataset.name, encoding_name(encoding),
+                            compressed ? "lz4" : "raw", up, down, producer_ns, engine_ns);
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+// Compares the stringstream parser request lines used to go through with
+// parse_input_values() on lines shaped like the producer's: eight "%.3f" values, one in
+// ten an anomaly in a wider range and one in ten a short four-value line.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "InputParser.hpp"
+
+namespace
+{
+constexpr std::size_t kInputSize = 8;
+constexpr std::size_t kLines = 1000;
+
+std::vector<float> stringstream_parse(const std::string &input)
+{
+    std::vector<float> values;
+    std::stringstream stream(input);
+    float value = 0.0F;
+    while (stream >> value)
+    {
+        values.push_back(value);
+    }
+    return values;
+}
+
+std::vector<std::string> producer_lines()
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> normal(-1.0F, 1.0F);
+    std::uniform_real_distribution<float> anomaly(-2.0F, 2.0F);
+    std::uniform_real_distribution<float> invalid(0.0F, 100.0F);
+
+    std::vector<std::string> lines;
+    lines.reserve(kLines);
+    for (std::size_t i = 0; i < kLines; ++i)
+    {
+        auto &range = (i % 10 == 9) ? invalid : (i % 10 == 4) ? anomaly : normal;
+        const std::size_t count = (i % 10 == 9) ? kInputSize / 2 : kInputSize;
+
+        std::string line;
+        char value[32];
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            std::snprintf(value, sizeof(value), "%s%.3f", k == 0 ? "" : " ", range(rng));
+            line += value;
+        }
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+template <typename Parse>
+double nanoseconds_per_line(const std::vector<std::string> &lines, int rounds, Parse &&parse)
+{
+    const auto started = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round)
+    {
+        for (const std::string &line : lines)
+        {
+            parse(line);
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - started;
+    return elapsed.count() / (static_cast<double>(rounds) * static_cast<double>(lines.size()));
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const int rounds = argc > 1 ? std::atoi(argv[1]) : 200;
+    const std::vector<std::string> lines = producer_lines();
+
+    // Both parsers must agree before their timings mean anything.
+    float output[kInputSize];
+    for (const std::string &line : lines)
+    {
+        const std::vector<float> expected = stringstream_parse(line);
+        const ds::ParseResult result = ds::parse_input_values(line, output);
+        bool same = result.status == ds::ParseStatus::Ok && result.count == expected.size();
+        for (std::size_t k = 0; same && k < expected.size(); ++k)
+        {
+            same = output[k] == expected[k];
+        }
+        if (!same)
+        {
+            std::fprintf(stderr, "Parsers disagree on \"%s\"\n", line.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    volatile float sink = 0.0F;
+    const double stringstream_ns = nanoseconds_per_line(lines, rounds, [&](const std::string &line) {
+        const std::vector<float> values = stringstream_parse(line);
+        sink = sink + values.front();
+    });
+    const double from_chars_ns = nanoseconds_per_line(lines, rounds, [&](const std::string &line) {
+        ds::parse_input_values(line, output);
+        sink = sink + output[0];
+    });
+
+    std::printf("%zu lines x %d rounds\n", lines.size(), rounds);
+    std::printf("stringstream:       %8.1f ns/line\n", stringstream_ns);
+    std::printf("parse_input_values: %8.1f ns/line\n", from_chars_ns);
+    std::printf("speedup:            %8.1fx\n", stringstream_ns / from_chars_ns);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+// Times TimerWheel with many entries: adding them, ticking while every entry stays
+// active, and ticking once they have all gone idle and expire.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "TimerWheel.hpp"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+struct TickTimes
+{
+    double average_us{0.0};
+    double worst_us{0.0};
+    std::size_t expired{0};
+};
+
+template <typename BeforeTick>
+TickTimes run_ticks(ds::TimerWheel &wheel, int ticks, BeforeTick &&before_tick)
+{
+    TickTimes times;
+    double total_us = 0.0;
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        before_tick();
+
+        const auto started = Clock::now();
+        wheel.advance([&](ds::TimerWheel::Entry &) { ++times.expired; });
+        const std::chrono::duration<double, std::micro> elapsed = Clock::now() - started;
+
+        total_us += elapsed.count();
+        times.worst_us = std::max(times.worst_us, elapsed.count());
+    }
+    times.average_us = total_us / ticks;
+    return times;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const std::size_t entries = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100'000;
+    // Matches AppConfig::idle_timeout_seconds with the servers' one-second tick.
+    const std::chrono::seconds timeout(300);
+    const int timeout_ticks = static_cast<int>(timeout.count());
+
+    ds::TimerWheel wheel(timeout);
+    std::vector<std::unique_ptr<ds::TimerWheel::Entry>> links;
+    links.reserve(entries);
+
+    const auto started = Clock::now();
+    for (std::size_t i = 0; i < entries; ++i)
+    {
+        links.push_back(std::make_unique<ds::TimerWheel::Entry>());
+        wheel.add(*links.back());
+    }
+    const std::chrono::duration<double, std::nano> add_time = Clock::now() - started;
+
+    // Three timeouts' worth of ticks with every entry touched in between, so entries
+    // keep being re-linked to their real deadlines and none expire.
+    const TickTimes busy = run_ticks(wheel, 3 * timeout_ticks, [&] {
+        for (auto &link : links)
+        {
+            wheel.touch(*link);
+        }
+    });
+
+    // Then no more activity: everything expires within one timeout.
+    const TickTimes idle = run_ticks(wheel, timeout_ticks + 1, [] {});
+
+    std::printf("%zu entries, %lld s timeout, sizeof(Entry) = %zu bytes\n",
+                entries,
+                static_cast<long long>(timeout.count()),
+                sizeof(ds::TimerWheel::Entry));
+    std::printf("add:        %8.1f ns/entry\n", add_time.count() / static_cast<double>(entries));
+    std::printf("busy ticks: %8.1f us avg %8.1f us worst, %zu expired\n", busy.average_us, busy.worst_us, busy.expired);
+    std::printf("idle ticks: %8.1f us avg %8.1f us worst, %zu expired\n", idle.average_us, idle.worst_us, idle.expired);
+
+    if (busy.expired != 0 || idle.expired != entries || wheel.size() != 0)
+    {
+        std::fprintf(stderr, "Unexpected expiries\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
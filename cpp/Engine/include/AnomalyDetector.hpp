@@ -1,6 +1,8 @@
 #pragma once
 
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "IInferenceBackend.hpp"
@@ -18,7 +20,8 @@ struct DetectionResult
     double mse;
     DetectionStatus status;
 
-    std::string response_line() const;
+    // Text protocol reply, backed by static storage.
+    std::string_view response_line() const;
 };
 
 class AnomalyDetector
@@ -27,8 +30,12 @@ public:
     AnomalyDetector(IInferenceBackend &backend, double threshold);
 
     DetectionResult evaluate(const std::vector<float> &input);
+    // Scores results.size() row-major vectors from `inputs` with one backend call.
+    void evaluate_batch(std::span<const float> inputs, std::span<DetectionResult> results);
 
 private:
+    DetectionResult classify(double mse) const;
+
     IInferenceBackend &backend_;
     double threshold_;
 };
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace ds
+{
+struct AnomalyReport
+{
+    std::string source;
+    std::optional<std::uint64_t> request_id;
+    double mse;
+};
+
+// Destination for anomalies detected on transports that never answer the sender.
+class IAnomalySink
+{
+public:
+    virtual ~IAnomalySink() = default;
+
+    virtual void report(const AnomalyReport &report) = 0;
+};
+
+// Writes each anomaly to the engine log.
+class LogAnomalySink final : public IAnomalySink
+{
+public:
+    void report(const AnomalyReport &report) override;
+};
+
+// Forwards each anomaly as a single text datagram to a collector.
+class UdpAnomalySink final : public IAnomalySink
+{
+public:
+    UdpAnomalySink(const std::string &host, const std::string &port);
+    ~UdpAnomalySink() override;
+
+    UdpAnomalySink(const UdpAnomalySink &) = delete;
+    UdpAnomalySink &operator=(const UdpAnomalySink &) = delete;
+
+    void report(const AnomalyReport &report) override;
+
+private:
+    int fd_{-1};
+};
+
+// Accepts "log" or "udp:<host>:<port>".
+std::unique_ptr<IAnomalySink> create_anomaly_sink(const std::string &spec);
+
+std::string format_anomaly_report(const AnomalyReport &report);
+} // namespace ds
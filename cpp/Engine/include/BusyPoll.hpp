@@ -0,0 +1,18 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+
+#include <chrono>
+
+namespace ds
+{
+// Runs `io_context` on the calling thread. After the last handler ran, the thread keeps
+// polling the reactor without blocking for `spin`, then falls back to a blocking wait.
+// A zero `spin` is plain io_context::run().
+void run_busy_polling(boost::asio::io_context &io_context, std::chrono::microseconds spin);
+
+// Asks the kernel to busy-poll the device queue for `spin` on blocking reads of this
+// socket (SO_BUSY_POLL). Raising it above net.core.busy_read needs CAP_NET_ADMIN;
+// failures are logged once and otherwise ignored.
+void enable_socket_busy_poll(int socket_fd, std::chrono::microseconds spin);
+} // namespace ds
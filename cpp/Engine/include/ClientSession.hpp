@@ -1,23 +1,98 @@
 #pragma once
 
-#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/generic/stream_protocol.hpp>
+
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "AnomalyDetector.hpp"
+#include "InferenceScheduler.hpp"
+#include "ReplyBuffer.hpp"
+#include "RequestMetrics.hpp"
+#include "SessionProtocol.hpp"
+#include "SlabPool.hpp"
+#include "TimerWheel.hpp"
 
 namespace ds
 {
-class ClientSession
+// Serves the text and binary request protocols over any connected stream socket
+// (TCP or Unix domain). With an `idle_timer` the session closes once it has seen no
+// input for the wheel's timeout while nothing is in flight.
+class ClientSession : public std::enable_shared_from_this<ClientSession>, private TimerWheel::Entry
 {
 public:
-    ClientSession(boost::asio::ip::tcp::socket &socket,
+    using Socket = boost::asio::generic::stream_protocol::socket;
+
+    ClientSession(Socket socket,
+                  std::string peer,
                   AnomalyDetector &detector,
-                  std::size_t expected_input_size);
+                  InferenceScheduler &scheduler,
+                  std::size_t expected_input_size,
+                  TimerWheel *idle_timer = nullptr);
+    ~ClientSession();
+
+    // Allocates the session and its control block from the slab pool. The session's
+    // block goes back with the last strong reference, even while weak ones remain.
+    static std::shared_ptr<ClientSession> create(Socket socket,
+                                                 std::string peer,
+                                                 AnomalyDetector &detector,
+                                                 InferenceScheduler &scheduler,
+                                                 std::size_t expected_input_size,
+                                                 TimerWheel *idle_timer = nullptr);
+
+    void start();
 
-    void run();
+    // Stops reading at the next request boundary and closes once every reply is out, so
+    // every request is either answered or never read. stop() closes right away. Both are
+    // safe to call from any thread.
+    void drain();
+    void stop();
+
+    // Expiry handler for TimerWheel::advance() on a wheel that holds sessions; hands
+    // the expired session over to its own strand.
+    static void expire_idle(TimerWheel::Entry &entry);
 
 private:
-    boost::asio::ip::tcp::socket &socket_;
-    AnomalyDetector &detector_;
-    std::size_t expected_input_size_;
+    bool read_some();
+    void maybe_read();
+    void read_later();
+    bool process_input(std::string_view received);
+    void on_idle_expired();
+    void flush();
+    void dispatch_tagged(std::uint64_t request_id, std::vector<float> values);
+    void complete_tagged(std::uint64_t request_id, std::exception_ptr error, const DetectionResult &result);
+    bool at_request_boundary() const;
+    void close_when_drained();
+    void close();
+
+    Socket socket_;
+    std::string peer_;
+    InferenceScheduler &scheduler_;
+    SessionProtocol protocol_;
+    TimerWheel *idle_timer_;
+    // Bytes of an incomplete (or held back) request carried over to the next read.
+    // Reads land in a per-thread buffer, so an idle session owns no receive buffer.
+    SlabString pending_;
+
+    // Replies keep collecting in replies_ while earlier ones are on the wire; every
+    // flush sends all queued chunks with one gather write.
+    ReplyBuffer replies_;
+    SlabVector<iovec> write_segments_;
+    SlabVector<boost::asio::const_buffer> write_buffers_;
+    bool writing_{false};
+
+    // At most one read or readiness wait is outstanding, and none while replies are
+    // being written or while the scheduler refuses more tagged requests from this
+    // connection; TCP flow control then pushes back on the sender.
+    ThrottleTimer throttle_;
+    bool reading_{false};
+    bool read_closed_{false};
+    bool draining_{false};
+    bool closed_{false};
 };
 } // namespace ds
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -10,5 +11,18 @@ struct AppConfig
     std::string model_path{"models/model.onnx"};
     std::string runtime_config_path{"models/config.json"};
     std::uint16_t server_port{9000};
+    std::uint16_t grpc_port{9001};           // gRPC port when it is served next to TCP
+    std::size_t grpc_completion_queues{0};   // 0 = one queue and polling thread per hardware core
+    std::size_t grpc_calls_per_queue{256};   // preallocated call slots; RPCs beyond them wait in gRPC
+    std::size_t tcp_worker_threads{0};       // 0 = one thread per hardware core
+    std::size_t inference_worker_threads{0}; // 0 = one thread per hardware core
+    std::size_t inference_max_batch_rows{64}; // queued requests scored by one backend call
+    std::uint32_t shm_spin_microseconds{50};  // busy-poll window before the shm thread sleeps
+    std::uint32_t tcp_busy_poll_microseconds{0}; // 0 = TCP I/O threads block right away
+    std::size_t max_in_flight_per_connection{256}; // tagged requests before a connection stops reading
+    std::size_t max_in_flight_total{4096};         // tagged requests across all connections; 0 = no cap
+    std::uint32_t metrics_log_interval_seconds{60}; // 0 = no periodic metrics log
+    std::uint32_t idle_timeout_seconds{300};        // silent TCP connections are closed; 0 = never
+    std::uint32_t handoff_drain_seconds{30};        // after a handoff, connections still open are closed
 };
 } // namespace ds
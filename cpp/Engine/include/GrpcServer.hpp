@@ -1,24 +1,84 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
-#include "AnomalyDetector.hpp"
+#include "InferenceScheduler.hpp"
+
+namespace grpc
+{
+class Server;
+class ServerCompletionQueue;
+class Service;
+} // namespace grpc
 
 namespace ds
 {
+// gRPC front end on the asynchronous API. Every completion queue has one polling
+// thread and call slots that are recycled from one RPC to the next: fixed sets for the
+// unary Evaluate and EvaluateBatch and one per open EvaluateStream. Requests are scored through the
+// shared InferenceScheduler, so no thread blocks on inference and they batch together
+// with whatever the TCP front end submits in the same process.
 class GrpcServer
 {
 public:
     GrpcServer(std::uint16_t port,
-               AnomalyDetector &detector,
-               std::size_t expected_input_size);
+               InferenceScheduler &scheduler,
+               std::size_t expected_input_size,
+               std::size_t completion_queues = 0,
+               std::size_t calls_per_queue = 256);
+    ~GrpcServer();
+
+    GrpcServer(const GrpcServer &) = delete;
+    GrpcServer &operator=(const GrpcServer &) = delete;
 
+    // Starts the polling threads and returns.
+    void start();
+    // Blocks until the server shuts down.
+    void wait();
+    // Stops accepting calls and returns once the running ones have finished; calls
+    // still running after `deadline` are cancelled.
+    void shutdown(std::chrono::seconds deadline);
     void run();
 
 private:
+    class Tag;
+    template <typename Request, typename Response>
+    class UnaryCall;
+    class EvaluateCall;
+    class EvaluateBatchCall;
+    class StreamCall;
+
+    void poll(grpc::ServerCompletionQueue &queue);
+    void add_stream_slot(grpc::ServerCompletionQueue &queue, std::size_t &idle_slots);
+    void adopt(std::unique_ptr<Tag> call);
+    void retire();
+
     std::uint16_t port_;
-    AnomalyDetector &detector_;
+    InferenceScheduler &scheduler_;
     std::size_t expected_input_size_;
+    std::size_t completion_queues_;
+    std::size_t calls_per_queue_;
+    std::unique_ptr<grpc::Service> service_;
+    std::unique_ptr<grpc::Server> server_;
+    std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> queues_;
+    std::vector<std::size_t> idle_stream_slots_;
+    std::vector<std::thread> pollers_;
+
+    // Once stopping, finished calls retire instead of waiting for the next RPC; the
+    // queues can shut down when every call slot has retired.
+    std::atomic<bool> stopping_{false};
+    std::mutex mutex_;
+    std::condition_variable state_changed_;
+    std::vector<std::unique_ptr<Tag>> calls_;
+    std::size_t retired_calls_{0};
+    bool stopped_{false};
 };
 } // namespace ds
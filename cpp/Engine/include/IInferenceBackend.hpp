@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -14,5 +15,9 @@ public:
     virtual std::string backend_name() const = 0;
     virtual std::size_t expected_input_size() const = 0;
     virtual std::vector<float> reconstruct(const std::vector<float> &input) = 0;
+
+    // Reconstructs row-major vectors of expected_input_size() values each into `output`,
+    // which must be as large as `input`. The default runs reconstruct() row by row.
+    virtual void reconstruct_batch(std::span<const float> input, std::span<float> output);
 };
 } // namespace ds
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <boost/asio/any_io_executor.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "AnomalyDetector.hpp"
+#include "RequestMetrics.hpp"
+
+namespace ds
+{
+// Caps on tagged requests queued or running on the inference workers; 0 = no cap.
+struct InFlightLimits
+{
+    std::size_t per_connection{0};
+    std::size_t total{0};
+};
+
+// Runs detector evaluations on a dedicated worker pool so front ends can complete
+// requests out of order instead of blocking their I/O threads on inference. Requests
+// share one queue; a free worker takes everything queued, up to `max_batch_rows`, and
+// scores it with one backend call, so batches grow with load without ever waiting to
+// fill. Every front end that submits here is batched together.
+class InferenceScheduler
+{
+public:
+    using Completion = std::function<void(std::exception_ptr, const DetectionResult &)>;
+    using BatchCompletion = std::function<void(std::exception_ptr, std::span<const DetectionResult>)>;
+
+    InferenceScheduler(AnomalyDetector &detector,
+                       std::size_t worker_threads,
+                       InFlightLimits limits = {},
+                       std::size_t max_batch_rows = 1);
+    // Scores on `executor` as a single worker instead of starting a pool, so a front
+    // end driven by one thread keeps inference on that thread too.
+    InferenceScheduler(AnomalyDetector &detector,
+                       boost::asio::any_io_executor executor,
+                       InFlightLimits limits = {},
+                       std::size_t max_batch_rows = 1);
+    ~InferenceScheduler();
+
+    InferenceScheduler(const InferenceScheduler &) = delete;
+    InferenceScheduler &operator=(const InferenceScheduler &) = delete;
+
+    // `on_complete` runs on a worker thread; callers hop back to their own executor.
+    void submit(std::vector<float> input, Completion on_complete);
+    // Scores `rows` row-major vectors from `inputs` with one backend call on a worker.
+    // They are a batch already, so they bypass the shared queue and count as one
+    // request in flight.
+    void submit_batch(std::vector<float> inputs, std::size_t rows, BatchCompletion on_complete);
+
+    // Whether a connection with `connection_in_flight` requests still running may read
+    // more. A connection with nothing in flight is always admitted: its own
+    // completions are what wake a throttled connection, so it must never wait on
+    // other connections draining the shared queue.
+    bool admits(std::size_t connection_in_flight) const;
+
+    std::size_t in_flight() const;
+    std::size_t worker_threads() const;
+
+private:
+    struct Request
+    {
+        std::vector<float> input;
+        Completion on_complete;
+    };
+
+    void count_submitted();
+    void drain();
+    void score(std::vector<Request> &batch);
+    void finish(Request &request, std::exception_ptr error, const DetectionResult &result);
+
+    AnomalyDetector &detector_;
+    std::size_t worker_threads_;
+    InFlightLimits limits_;
+    std::size_t max_batch_rows_;
+    QueueDepthGauge in_flight_;
+    std::mutex mutex_;
+    std::deque<Request> queue_;
+    // Workers currently draining the queue; never more than worker_threads_.
+    std::size_t draining_{0};
+    std::optional<boost::asio::thread_pool> pool_;
+    boost::asio::any_io_executor executor_;
+};
+} // namespace ds
@@ -1,9 +1,51 @@
 #pragma once
 
-#include <string>
-#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "InputTokenizer.hpp"
 
 namespace ds
 {
-std::vector<float> parse_input_line(const std::string &input);
+// Request lines whose first token starts with this character carry a client-chosen
+// request id, e.g. "@42 0.1 0.2 ...".
+constexpr char kRequestIdPrefix = '@';
+
+// A line whose first token is this keyword opens a batch, e.g. "BATCH 3": the next
+// three lines are scored together and answered as one block.
+constexpr std::string_view kBatchKeyword = "BATCH";
+
+enum class ParseStatus
+{
+    Ok,
+    Malformed,
+    TooManyValues
+};
+
+struct ParseResult
+{
+    ParseStatus status;
+    std::size_t count;
+};
+
+// Parses whitespace-separated numbers in place into `output`. Parsing stops at the
+// first malformed token, or as soon as the line holds more values than `output` fits.
+ParseResult parse_input_values(std::string_view input, std::span<float> output);
+
+// Parses a single already-delimited token, e.g. one produced by tokenize_lines().
+bool parse_input_value(std::string_view token, float &value);
+
+// Parses the tokens of one request line from `text`, including an optional leading
+// request id. `count` is the number of values written to `output`.
+ParseResult parse_request_line(std::string_view text,
+                               std::span<const TextToken> tokens,
+                               std::span<float> output,
+                               std::optional<std::uint64_t> &request_id);
+
+// Returns false when `tokens` do not start with kBatchKeyword. Otherwise `rows` is the
+// announced row count, or 0 when the header is malformed.
+bool parse_batch_header(std::string_view text, std::span<const TextToken> tokens, std::size_t &rows);
 } // namespace ds
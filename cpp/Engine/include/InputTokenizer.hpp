@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace ds
+{
+struct TextToken
+{
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+struct TextLine
+{
+    std::uint32_t offset;
+    std::uint32_t length;
+    std::uint32_t first_token;
+    std::uint32_t token_count;
+};
+
+// Token and line spans for every complete ('\n'-terminated) line of a buffer.
+// Offsets are relative to the start of the tokenized text; `consumed` is the
+// number of bytes covered by `lines`, i.e. everything up to the last newline.
+struct TokenizedText
+{
+    std::vector<TextToken> tokens;
+    std::vector<TextLine> lines;
+    std::size_t consumed{0};
+
+    void clear();
+};
+
+// Splits a whole buffer into lines and whitespace-separated tokens in one pass.
+// Uses AVX2 or SSE4.2 when the CPU supports them and a scalar scan otherwise.
+void tokenize_lines(std::string_view text, TokenizedText &out);
+
+// tokenize_lines() with the named instruction set ("avx2", "sse4.2" or "scalar")
+// instead of the one selected at runtime, so tests can compare every path. Returns
+// false when this CPU lacks it.
+bool tokenize_lines_with(std::string_view isa_name, std::string_view text, TokenizedText &out);
+
+// Name of the instruction set selected at runtime ("avx2", "sse4.2" or "scalar").
+const char *tokenizer_isa_name();
+} // namespace ds
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ds::uring
+{
+// Minimal owner of one io_uring instance, talking to the kernel interface directly.
+// Not thread-safe: a ring belongs to the thread that submits on it.
+class Ring
+{
+public:
+    explicit Ring(unsigned entries);
+    ~Ring();
+
+    Ring(const Ring &) = delete;
+    Ring &operator=(const Ring &) = delete;
+
+    // Returns a zeroed submission entry, submitting queued entries first if the
+    // submission queue is full.
+    io_uring_sqe &next_sqe();
+
+    // Submits everything queued and waits until at least `wait_for` completions
+    // are available.
+    void submit_and_wait(unsigned wait_for);
+
+    // Calls `handler(const io_uring_cqe &)` for every available completion and
+    // returns how many were handled.
+    template <typename Handler> unsigned drain_completions(Handler &&handler);
+
+    int fd() const;
+
+private:
+    unsigned pending_submissions() const;
+
+    int fd_{-1};
+    void *sq_mapping_{nullptr};
+    std::size_t sq_mapping_size_{0};
+    void *cq_mapping_{nullptr};
+    std::size_t cq_mapping_size_{0};
+    io_uring_sqe *sqes_{nullptr};
+    std::size_t sqes_size_{0};
+
+    unsigned *sq_head_{nullptr};
+    unsigned *sq_tail_{nullptr};
+    unsigned sq_mask_{0};
+    unsigned sq_entries_{0};
+    unsigned *sq_array_{nullptr};
+    unsigned sq_local_tail_{0};
+
+    unsigned *cq_head_{nullptr};
+    unsigned *cq_tail_{nullptr};
+    unsigned cq_mask_{0};
+    io_uring_cqe *cqes_{nullptr};
+};
+
+// A kernel-registered ring of equally sized receive buffers. Multishot receives pick
+// a buffer from the group themselves; the owner hands it back with recycle() once
+// its bytes have been consumed.
+class BufferRing
+{
+public:
+    BufferRing(Ring &ring, std::uint16_t group_id, std::uint16_t buffer_count, std::size_t buffer_size);
+    ~BufferRing();
+
+    BufferRing(const BufferRing &) = delete;
+    BufferRing &operator=(const BufferRing &) = delete;
+
+    std::uint16_t group_id() const;
+    std::span<char> buffer(std::uint16_t buffer_id, std::size_t length);
+    void recycle(std::uint16_t buffer_id);
+
+private:
+    Ring &ring_;
+    std::uint16_t group_id_;
+    std::uint16_t buffer_count_;
+    std::size_t buffer_size_;
+    io_uring_buf_ring *entries_{nullptr};
+    std::size_t entries_size_{0};
+    std::vector<char> storage_;
+};
+
+// Probes whether the running kernel provides everything the io_uring transport
+// relies on: provided buffer rings, multishot accept and multishot receive.
+bool kernel_supports_multishot();
+
+template <typename Handler> unsigned Ring::drain_completions(Handler &&handler)
+{
+    unsigned head = *cq_head_;
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+    unsigned handled = 0;
+    for (; head != tail; ++head, ++handled)
+    {
+        handler(static_cast<const io_uring_cqe &>(cqes_[head & cq_mask_]));
+    }
+
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    return handled;
+}
+} // namespace ds::uring
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace ds
+{
+// Listening sockets of the stream front end; -1 where a server opens its own.
+struct Listeners
+{
+    int tcp{-1};
+    int local{-1};
+};
+
+// Old side of a zero-downtime restart. Offers this process's listening sockets on a
+// Unix control socket; a replacement that takes them over (ListenerTakeover) gets
+// them passed with SCM_RIGHTS, so the kernel keeps accepting into the same queue
+// throughout. Once the replacement confirms it is serving, `on_released` runs on the
+// offer's thread to stop accepting and drain this process.
+class ListenerOffer
+{
+public:
+    ListenerOffer(std::string control_path, Listeners listeners, std::function<void()> on_released);
+    ~ListenerOffer();
+
+    ListenerOffer(const ListenerOffer &) = delete;
+    ListenerOffer &operator=(const ListenerOffer &) = delete;
+
+    void start();
+
+private:
+    void run();
+    bool hand_off(int connection);
+
+    std::string control_path_;
+    Listeners listeners_;
+    std::function<void()> on_released_;
+    int control_fd_{-1};
+    int stop_fd_{-1};
+    std::thread thread_;
+};
+
+// New side of a zero-downtime restart. Connects to the control socket of a running
+// engine and receives its listeners; without one (first start) nothing is taken and
+// the servers bind as usual.
+class ListenerTakeover
+{
+public:
+    explicit ListenerTakeover(const std::string &control_path);
+    ~ListenerTakeover();
+
+    ListenerTakeover(const ListenerTakeover &) = delete;
+    ListenerTakeover &operator=(const ListenerTakeover &) = delete;
+
+    bool taken() const { return taken_; }
+    const Listeners &listeners() const { return listeners_; }
+
+    // Tells the old engine this one is accepting, which starts its drain.
+    void confirm();
+
+private:
+    Listeners listeners_;
+    int control_fd_{-1};
+    bool taken_{false};
+};
+} // namespace ds
@@ -3,15 +3,28 @@
 #include <iostream>
 #include <string>
 
+// Per-request messages are compiled in only when the build sets DS_DEBUG_LOG=1.
+#ifndef DS_DEBUG_LOG
+#define DS_DEBUG_LOG 0
+#endif
+
 namespace ds::log
 {
-constexpr bool kDebugLog = true;
+constexpr bool kDebugLog = DS_DEBUG_LOG != 0;
 
 inline void info(const std::string &message)
 {
-    if (kDebugLog)
+    std::cout << "[INFO] " << message << std::endl;
+}
+
+// Logs one message per request. `make_message` returns the text and is only called
+// when debug logging is compiled in, so request paths build no strings otherwise.
+template <typename MakeMessage>
+void debug(MakeMessage &&make_message)
+{
+    if constexpr (kDebugLog)
     {
-        std::cout << "[INFO] " << message << std::endl;
+        std::cout << "[DEBUG] " << make_message() << '\n';
     }
 }
 
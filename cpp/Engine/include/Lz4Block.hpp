@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+namespace ds::lz4
+{
+// Raw LZ4 blocks (no frame format) for compressed binary batch frames. The codec is
+// only linked in with -DDS_ENABLE_LZ4=ON; without it every call but available() throws.
+bool available();
+
+// Largest compressed size of `size` input bytes.
+std::size_t compress_bound(std::size_t size);
+
+// Compresses `input` into `output`, which must hold compress_bound(input.size())
+// bytes, and returns the compressed size.
+std::size_t compress(std::string_view input, std::span<char> output);
+
+// Decompresses one block; true only if it is well formed and expands to exactly
+// `output.size()` bytes.
+bool decompress(std::string_view input, std::span<char> output);
+} // namespace ds::lz4
@@ -17,9 +17,12 @@ public:
     std::string backend_name() const override;
     std::size_t expected_input_size() const override;
     std::vector<float> reconstruct(const std::vector<float> &input) override;
+    void reconstruct_batch(std::span<const float> input, std::span<float> output) override;
 
 private:
     std::size_t resolve_expected_input_size() const;
+    bool resolve_dynamic_batch() const;
+    void run(const float *input, std::size_t rows, float *output);
 
     Ort::Env env_;
     Ort::Session session_;
@@ -31,5 +34,6 @@ private:
     std::vector<const char *> output_names_;
 
     std::size_t expected_input_size_;
+    bool dynamic_batch_;
 };
 } // namespace ds
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "SlabPool.hpp"
+
+namespace ds
+{
+// Outgoing reply bytes of one connection, stored in fixed-size chunks drawn from the
+// slab pool instead of one growing string. Chunks never move once written, so
+// a transport can keep a gather write in flight over the queued bytes while new
+// replies are appended behind them, and release the bytes with consume() once sent.
+class ReplyBuffer
+{
+public:
+    static constexpr std::size_t kChunkSize = slab::kMaxBlockSize;
+
+    ReplyBuffer() = default;
+    ~ReplyBuffer();
+
+    ReplyBuffer(const ReplyBuffer &) = delete;
+    ReplyBuffer &operator=(const ReplyBuffer &) = delete;
+
+    void append(std::string_view bytes);
+
+    // Appends iovecs covering up to `max_segments` chunks of queued bytes, in order,
+    // and returns how many bytes they cover.
+    std::size_t gather(SlabVector<iovec> &segments, std::size_t max_segments) const;
+
+    // Drops `bytes` from the front once a write has sent them.
+    void consume(std::size_t bytes);
+
+    bool empty() const;
+    std::size_t size() const;
+
+private:
+    struct Chunk
+    {
+        char *data;
+        std::size_t size;
+    };
+
+    void release_chunks();
+
+    // A handful of chunks at most; unlike a deque an empty vector allocates nothing,
+    // which keeps idle connections small.
+    SlabVector<Chunk> chunks_;
+    // Bytes of the front chunk that were already sent.
+    std::size_t head_{0};
+    std::size_t size_{0};
+};
+} // namespace ds
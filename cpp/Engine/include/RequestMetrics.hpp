@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace ds
+{
+// Counters for the tagged request path and the stream connections. Every thread
+// counts into a block of its own and every scheduler keeps its own queue depth, so
+// threads and shards never write to a shared cache line; collect_request_metrics()
+// sums them for MetricsReporter.
+struct RequestMetrics
+{
+    std::size_t queue_depth{0};      // tagged requests queued or running on inference workers
+    std::size_t peak_queue_depth{0}; // sum of each scheduler's highest depth since the last report
+    std::size_t throttled_connections{0};
+    std::uint64_t throttle_events{0};
+    std::uint64_t throttled_microseconds{0};
+    std::size_t open_connections{0}; // stream connections holding session state
+};
+
+// Sums every thread's and every scheduler's counters, and restarts the peaks from
+// the current depths so every report covers its own interval.
+RequestMetrics collect_request_metrics();
+
+// Called when a stream connection's session state is created and destroyed; the
+// two may run on different threads.
+void count_connection_opened();
+void count_connection_closed();
+
+// Requests one InferenceScheduler has in flight; it doubles as the scheduler's
+// admission count. Each gauge registers itself for collect_request_metrics().
+class QueueDepthGauge
+{
+public:
+    QueueDepthGauge();
+    ~QueueDepthGauge();
+
+    QueueDepthGauge(const QueueDepthGauge &) = delete;
+    QueueDepthGauge &operator=(const QueueDepthGauge &) = delete;
+
+    void add()
+    {
+        const std::size_t depth = depth_.fetch_add(1, std::memory_order_relaxed) + 1;
+        std::size_t peak = peak_.load(std::memory_order_relaxed);
+        while (peak < depth && !peak_.compare_exchange_weak(peak, depth, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void remove()
+    {
+        depth_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    std::size_t depth() const
+    {
+        return depth_.load(std::memory_order_relaxed);
+    }
+
+    // Returns the highest depth since the last call and restarts it from the current one.
+    std::size_t take_peak()
+    {
+        return peak_.exchange(depth(), std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::size_t> depth_{0};
+    std::atomic<std::size_t> peak_{0};
+};
+
+// Tracks the periods in which one connection stopped reading because it hit an
+// in-flight limit. Not thread-safe: it belongs to the connection's I/O thread.
+class ThrottleTimer
+{
+public:
+    ThrottleTimer() = default;
+    ~ThrottleTimer();
+
+    ThrottleTimer(const ThrottleTimer &) = delete;
+    ThrottleTimer &operator=(const ThrottleTimer &) = delete;
+
+    void begin();
+    void end();
+    bool active() const;
+
+private:
+    std::chrono::steady_clock::time_point started_;
+    bool active_{false};
+};
+
+// Logs collect_request_metrics() every `interval` from a background thread.
+class MetricsReporter
+{
+public:
+    explicit MetricsReporter(std::chrono::seconds interval);
+    ~MetricsReporter();
+
+    MetricsReporter(const MetricsReporter &) = delete;
+    MetricsReporter &operator=(const MetricsReporter &) = delete;
+
+    void start();
+
+private:
+    void run();
+
+    std::chrono::seconds interval_;
+    std::mutex mutex_;
+    std::condition_variable stop_requested_;
+    bool stopping_{false};
+    std::thread thread_;
+};
+} // namespace ds
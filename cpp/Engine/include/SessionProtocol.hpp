@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AnomalyDetector.hpp"
+#include "InputTokenizer.hpp"
+#include "ReplyBuffer.hpp"
+#include "WireProtocol.hpp"
+
+namespace ds
+{
+// The transport-independent half of a client connection: negotiates text or binary
+// framing, scores requests (text and binary batches and all untagged lines of one read
+// together) and formats replies. Transports own the socket, the
+// input bytes and the write path, and feed whatever they received to consume().
+class SessionProtocol
+{
+public:
+    // Hands a tagged request to the transport, which schedules it and later reports
+    // the outcome through complete_tagged() on the connection's own thread.
+    using TaggedDispatch = std::function<void(std::uint64_t request_id, std::vector<float> values)>;
+    // Decides whether one more tagged request may be dispatched while `in_flight` of
+    // this connection's requests are still running. Empty admits everything.
+    using TaggedAdmission = std::function<bool(std::size_t in_flight)>;
+
+    SessionProtocol(AnomalyDetector &detector,
+                    std::size_t expected_input_size,
+                    TaggedDispatch dispatch_tagged,
+                    TaggedAdmission admit_tagged = {});
+
+    // Processes every complete request in `input`, appends the replies to `replies`
+    // and returns the number of bytes consumed. Stops early, leaving the rest
+    // unconsumed, at the first tagged request that is not admitted. Throws on
+    // protocol violations, after which the connection must be closed.
+    std::size_t consume(std::string_view input, ReplyBuffer &replies);
+
+    // True when the last consume() stopped at an unadmitted tagged request; the
+    // transport feeds the remaining bytes again before reading anything new.
+    bool stalled() const;
+
+    void complete_tagged(std::uint64_t request_id,
+                         std::exception_ptr error,
+                         const DetectionResult &result,
+                         ReplyBuffer &replies);
+
+    std::size_t tagged_in_flight() const;
+
+private:
+    enum class WireMode
+    {
+        Undecided,
+        Text,
+        Binary
+    };
+
+    enum class LineOutcome
+    {
+        Valid,
+        Dispatched,
+        Malformed,
+        InvalidSize,
+        BatchHeader,
+        MalformedBatchHeader
+    };
+
+    struct LineRecord
+    {
+        LineOutcome outcome;
+        std::optional<std::uint64_t> request_id;
+        std::size_t batch_rows{0};
+    };
+
+    // Working storage of one consume_lines() call. It is shared by every session on a
+    // thread, so a connection keeps no batch-sized buffers between reads.
+    struct BatchScratch
+    {
+        TokenizedText tokenized;
+        std::vector<LineRecord> line_records;
+        std::vector<float> inputs;
+        std::vector<DetectionResult> results;
+        // Decompressed batch frame bodies that still need widening to float32.
+        std::vector<char> packed;
+    };
+
+    static BatchScratch &batch_scratch();
+
+    std::size_t negotiate_wire_mode(std::string_view input, ReplyBuffer &replies);
+    std::size_t consume_lines(std::string_view text, ReplyBuffer &replies);
+    std::size_t consume_frames(std::string_view data, ReplyBuffer &replies);
+    void score_batch_frame(const wire::FrameHeader &header, std::string_view body, ReplyBuffer &replies);
+    LineOutcome parse_line(std::string_view text,
+                           const TokenizedText &tokenized,
+                           const TextLine &line,
+                           std::span<float> output,
+                           std::optional<std::uint64_t> &request_id) const;
+    bool admit_tagged() const;
+    void dispatch(std::uint64_t request_id, std::vector<float> values);
+
+    AnomalyDetector &detector_;
+    std::size_t expected_input_size_;
+    TaggedDispatch dispatch_tagged_;
+    TaggedAdmission admit_tagged_;
+    bool stalled_{false};
+    // The last consume() stopped at a batch header whose rows have not all arrived.
+    bool awaiting_batch_{false};
+    WireMode wire_mode_{WireMode::Undecided};
+    std::vector<float> values_;
+    std::size_t tagged_in_flight_{0};
+};
+} // namespace ds
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "AnomalyDetector.hpp"
+#include "IInferenceBackend.hpp"
+#include "InferenceScheduler.hpp"
+#include "TimerWheel.hpp"
+
+namespace ds
+{
+// Shared-nothing TCP front end: every shard binds its own SO_REUSEPORT listener on
+// the same port and owns its io_context, backend, detector and scheduler, all driven
+// from one thread pinned to one core; tagged requests are scored on that thread too. The kernel spreads incoming
+// connections across the listeners, so requests never touch another shard's state.
+class ShardedTcpServer
+{
+public:
+    using BackendFactory = std::function<std::unique_ptr<IInferenceBackend>()>;
+
+    ShardedTcpServer(std::uint16_t port,
+                     std::size_t shard_count,
+                     const BackendFactory &create_backend,
+                     double threshold,
+                     InFlightLimits limits = {},
+                     std::chrono::microseconds busy_poll = {},
+                     std::chrono::seconds idle_timeout = {});
+    ~ShardedTcpServer();
+
+    ShardedTcpServer(const ShardedTcpServer &) = delete;
+    ShardedTcpServer &operator=(const ShardedTcpServer &) = delete;
+
+    void run();
+
+private:
+    struct Shard
+    {
+        Shard(std::uint16_t port,
+              std::unique_ptr<IInferenceBackend> shard_backend,
+              double threshold,
+              InFlightLimits limits,
+              std::chrono::seconds idle_timeout);
+
+        std::unique_ptr<IInferenceBackend> backend;
+        AnomalyDetector detector;
+        boost::asio::io_context io_context;
+        InferenceScheduler scheduler;
+        boost::asio::ip::tcp::acceptor acceptor;
+        std::optional<TimerWheel> idle_timer;
+        boost::asio::steady_timer idle_tick;
+    };
+
+    void do_accept(Shard &shard);
+    void do_idle_tick(Shard &shard);
+
+    std::uint16_t port_;
+    std::chrono::microseconds busy_poll_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+} // namespace ds
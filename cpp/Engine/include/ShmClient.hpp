@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "ShmTransport.hpp"
+
+namespace ds
+{
+struct ShmReply
+{
+    std::uint64_t request_id;
+    wire::ReplyStatus status;
+    double mse;
+};
+
+// Producer-side helper for the shared memory transport. Each instance claims one
+// channel of the engine's region; it is not thread-safe (one producer per channel).
+class ShmClient
+{
+public:
+    explicit ShmClient(const std::string &name,
+                       std::chrono::microseconds spin_duration = std::chrono::microseconds(50));
+    ~ShmClient();
+
+    ShmClient(const ShmClient &) = delete;
+    ShmClient &operator=(const ShmClient &) = delete;
+
+    std::size_t expected_input_size() const;
+
+    // Non-blocking; false when the request ring is full.
+    bool try_submit(std::uint64_t request_id, std::span<const float> values);
+    // Non-blocking; false when no reply is ready.
+    bool try_receive(ShmReply &reply);
+    // Spins for the configured duration, then sleeps until a reply arrives.
+    ShmReply receive();
+
+    // Convenience round trip for callers that keep one request in flight.
+    ShmReply evaluate(std::span<const float> values);
+
+private:
+    shm::Region *region_{nullptr};
+    shm::Channel *channel_{nullptr};
+    std::chrono::microseconds spin_duration_;
+    std::uint64_t next_request_id_{0};
+};
+} // namespace ds
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+#include "AnomalyDetector.hpp"
+#include "ShmTransport.hpp"
+
+namespace ds
+{
+// Serves same-host producers through a POSIX shared memory region holding one pair
+// of SPSC request/response rings per client. Requests are scored in place, straight
+// out of the ring, on a dedicated polling thread.
+class ShmServer
+{
+public:
+    ShmServer(const std::string &name,
+              AnomalyDetector &detector,
+              std::size_t expected_input_size,
+              std::chrono::microseconds spin_duration);
+    ~ShmServer();
+
+    ShmServer(const ShmServer &) = delete;
+    ShmServer &operator=(const ShmServer &) = delete;
+
+    void start();
+
+private:
+    void run();
+    bool drain_channel(shm::Channel &channel);
+    void recycle_channels();
+    bool has_pending_requests() const;
+
+    std::string name_;
+    AnomalyDetector &detector_;
+    std::size_t expected_input_size_;
+    std::chrono::microseconds spin_duration_;
+    shm::Region *region_{nullptr};
+    std::atomic<bool> stop_requested_{false};
+    std::thread thread_;
+};
+} // namespace ds
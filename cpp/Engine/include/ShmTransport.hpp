@@ -0,0 +1,171 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+#include "WireProtocol.hpp"
+
+// Shared-memory layout used by ShmServer (engine) and ShmClient (producer helper).
+// Both sides map the same POSIX shared memory object; every field that crosses the
+// process boundary is a lock-free atomic or is published through one.
+namespace ds::shm
+{
+constexpr std::uint32_t kRegionMagic = 0x314D5344; // "DSM1"
+constexpr std::uint32_t kRegionVersion = 2;
+constexpr std::size_t kCacheLine = 64;
+constexpr std::size_t kMaxValues = 64;
+constexpr std::size_t kRingCapacity = 1024;
+constexpr std::size_t kMaxChannels = 16;
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+
+// Channel lifecycle. Only the engine moves a channel back to Free, so a client can
+// never reset rings the engine is still reading. A client claims a channel by
+// swapping its pid into Channel::owner_pid while that is 0, before it touches the
+// state, so a client that dies partway through a claim still leaves a dead owner
+// behind for the engine to reclaim.
+enum class ChannelState : std::uint32_t
+{
+    Free = 0,
+    Claiming = 1,
+    Active = 2,
+    Released = 3
+};
+
+struct RequestSlot
+{
+    std::uint64_t request_id;
+    std::uint32_t count;
+    float values[kMaxValues];
+};
+
+struct ResponseSlot
+{
+    std::uint64_t request_id;
+    wire::ReplyStatus status;
+    double mse;
+};
+
+// Futex-backed wakeup: notifiers bump the sequence and only pay for a syscall when
+// somebody is actually asleep.
+struct Doorbell
+{
+    std::atomic<std::uint32_t> sequence{0};
+    std::atomic<std::uint32_t> sleepers{0};
+
+    void notify()
+    {
+        sequence.fetch_add(1);
+        if (sleepers.load() != 0)
+        {
+            syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&sequence), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+        }
+    }
+
+    // Callers re-check their condition between prepare_wait() and wait().
+    std::uint32_t prepare_wait()
+    {
+        sleepers.fetch_add(1);
+        return sequence.load();
+    }
+
+    void wait(std::uint32_t seen, const timespec &timeout)
+    {
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&sequence), FUTEX_WAIT, seen, &timeout, nullptr, 0);
+        sleepers.fetch_sub(1);
+    }
+
+    void cancel_wait()
+    {
+        sleepers.fetch_sub(1);
+    }
+};
+
+// Single-producer/single-consumer ring. Slots are written and read in place.
+template <typename T, std::size_t Capacity>
+struct SpscRing
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "ring capacity must be a power of two");
+
+    alignas(kCacheLine) std::atomic<std::uint64_t> head{0};
+    alignas(kCacheLine) std::atomic<std::uint64_t> tail{0};
+    alignas(kCacheLine) T slots[Capacity];
+
+    void reset()
+    {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    T *producer_slot()
+    {
+        const std::uint64_t current = head.load(std::memory_order_relaxed);
+        if (current - tail.load(std::memory_order_acquire) == Capacity)
+        {
+            return nullptr;
+        }
+        return &slots[current & (Capacity - 1)];
+    }
+
+    void publish()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    const T *consumer_slot() const
+    {
+        const std::uint64_t current = tail.load(std::memory_order_relaxed);
+        if (current == head.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+        return &slots[current & (Capacity - 1)];
+    }
+
+    void release()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+        return tail.load(std::memory_order_relaxed) == head.load(std::memory_order_acquire);
+    }
+};
+
+struct alignas(kCacheLine) Channel
+{
+    std::atomic<ChannelState> state{ChannelState::Free};
+    // 0 exactly when the channel can be claimed; the engine clears it last when it
+    // frees a channel.
+    std::atomic<std::int32_t> owner_pid{0};
+    Doorbell client_doorbell;
+    SpscRing<RequestSlot, kRingCapacity> requests;
+    SpscRing<ResponseSlot, kRingCapacity> responses;
+};
+
+struct Region
+{
+    std::atomic<std::uint32_t> magic{0};
+    std::uint32_t version{kRegionVersion};
+    std::uint32_t expected_input_size{0};
+    alignas(kCacheLine) Doorbell engine_doorbell;
+    Channel channels[kMaxChannels];
+};
+
+inline timespec to_timespec(std::uint64_t microseconds)
+{
+    return timespec{
+        .tv_sec = static_cast<time_t>(microseconds / 1'000'000),
+        .tv_nsec = static_cast<long>((microseconds % 1'000'000) * 1'000),
+    };
+}
+} // namespace ds::shm
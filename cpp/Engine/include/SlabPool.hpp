@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ds
+{
+// Fixed-size blocks for per-connection state: session objects, carried-over input
+// and reply chunks. Blocks come in power-of-two size classes from kMinBlockSize to
+// kMaxBlockSize and are carved out of kSlabSize slabs that are never given back, so a
+// storm of short-lived connections keeps reusing the same memory instead of churning
+// the heap. Every thread allocates from and frees into its own free lists; surplus
+// blocks, and the lists of threads that exit, go to a shared depot that refills the
+// others. Larger requests fall through to operator new.
+namespace slab
+{
+constexpr std::size_t kMinBlockSize = 64;
+constexpr std::size_t kMaxBlockSize = 16 * 1024;
+constexpr std::size_t kSlabSize = 64 * 1024;
+
+void *allocate(std::size_t bytes);
+void deallocate(void *block, std::size_t bytes) noexcept;
+
+struct Usage
+{
+    std::size_t reserved_bytes; // slabs carved so far plus live oversized blocks
+    std::size_t in_use_bytes;   // blocks handed out, counted at their size class
+};
+
+Usage usage();
+} // namespace slab
+
+template <typename T>
+class SlabAllocator
+{
+public:
+    static_assert(alignof(T) <= slab::kMinBlockSize, "slab blocks are aligned to kMinBlockSize");
+
+    using value_type = T;
+
+    SlabAllocator() noexcept = default;
+    template <typename U>
+    SlabAllocator(const SlabAllocator<U> &) noexcept
+    {
+    }
+
+    T *allocate(std::size_t count)
+    {
+        return static_cast<T *>(slab::allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T *pointer, std::size_t count) noexcept
+    {
+        slab::deallocate(pointer, count * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const SlabAllocator<U> &) const noexcept
+    {
+        return true;
+    }
+};
+
+template <typename T>
+using SlabVector = std::vector<T, SlabAllocator<T>>;
+using SlabString = std::basic_string<char, std::char_traits<char>, SlabAllocator<char>>;
+
+template <typename T>
+struct SlabDelete
+{
+    void operator()(T *object) const noexcept
+    {
+        object->~T();
+        slab::deallocate(object, sizeof(T));
+    }
+};
+
+template <typename T>
+using SlabPtr = std::unique_ptr<T, SlabDelete<T>>;
+
+template <typename T, typename... Args>
+SlabPtr<T> make_slab(Args &&...args)
+{
+    static_assert(alignof(T) <= slab::kMinBlockSize, "slab blocks are aligned to kMinBlockSize");
+
+    void *block = slab::allocate(sizeof(T));
+    try
+    {
+        return SlabPtr<T>(new (block) T(std::forward<Args>(args)...));
+    }
+    catch (...)
+    {
+        slab::deallocate(block, sizeof(T));
+        throw;
+    }
+}
+} // namespace ds
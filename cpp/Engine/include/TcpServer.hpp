@@ -2,23 +2,81 @@
 
 #include <boost/asio.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
 #include "AnomalyDetector.hpp"
+#include "InferenceScheduler.hpp"
+#include "ListenerHandoff.hpp"
+#include "TimerWheel.hpp"
 
 namespace ds
 {
+class ClientSession;
+
 class TcpServer
 {
 public:
+    // A non-empty `unix_socket_path` additionally serves the same protocols on an
+    // AF_UNIX stream socket for producers running on the same host. A non-zero
+    // `busy_poll` makes worker threads spin that long before blocking for I/O, and a
+    // non-zero `idle_timeout` closes connections that stay silent that long. Listeners
+    // in `inherited` (taken over from a previous engine) are served instead of binding.
     TcpServer(std::uint16_t port,
               AnomalyDetector &detector,
-              std::size_t expected_input_size);
+              InferenceScheduler &scheduler,
+              std::size_t expected_input_size,
+              std::size_t worker_threads,
+              const std::string &unix_socket_path = {},
+              std::chrono::microseconds busy_poll = {},
+              std::chrono::seconds idle_timeout = {},
+              Listeners inherited = {});
+    // Removes the Unix socket file unless the listener was handed to a replacement.
+    ~TcpServer();
 
     void run();
 
+    Listeners listeners();
+
+    // Stops accepting and lets every connection finish its current request, then
+    // makes run() return. Connections still open after `deadline` are closed. Safe
+    // to call from any thread; only called once the listeners have been handed over.
+    void drain(std::chrono::seconds deadline);
+
 private:
+    void do_accept();
+    void do_accept_local();
+    void do_idle_tick();
+    void track(const std::shared_ptr<ClientSession> &session);
+    void check_drained(std::chrono::steady_clock::time_point deadline);
+
     boost::asio::io_context io_context_;
+    // Accepts, the idle tick and the drain run on this strand; the timers below use it
+    // as their executor, so drain() can cancel the idle tick while its handler re-arms.
+    boost::asio::strand<boost::asio::io_context::executor_type> accept_strand_;
     boost::asio::ip::tcp::acceptor acceptor_;
+    std::optional<boost::asio::local::stream_protocol::acceptor> local_acceptor_;
+    std::string unix_socket_path_;
+    // Set by drain(): the socket file then belongs to the replacement engine.
+    std::atomic<bool> handed_off_{false};
     AnomalyDetector &detector_;
+    InferenceScheduler &scheduler_;
     std::size_t expected_input_size_;
+    std::size_t worker_threads_;
+    std::chrono::microseconds busy_poll_;
+    std::optional<TimerWheel> idle_timer_;
+    boost::asio::steady_timer idle_tick_;
+
+    // Live sessions, for drain(); expired entries are pruned as the list grows.
+    std::mutex sessions_mutex_;
+    std::vector<std::weak_ptr<ClientSession>> sessions_;
+    std::size_t prune_at_;
+    boost::asio::steady_timer drain_timer_;
+    bool sessions_stopped_{false};
 };
 } // namespace ds
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <thread>
+
+namespace ds
+{
+// Resolves a configured thread count, where 0 means one thread per hardware core.
+inline std::size_t resolve_thread_count(std::size_t requested)
+{
+    if (requested > 0)
+    {
+        return requested;
+    }
+
+    const unsigned int cores = std::thread::hardware_concurrency();
+    return (cores > 0) ? cores : 1;
+}
+} // namespace ds
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace ds
+{
+// Hashed timing wheel for one uniform idle timeout. Entries are intrusive links
+// embedded in whatever is being timed, so scheduling never allocates. Activity only
+// stamps the entry with the current tick; an entry whose slot comes up is either
+// expired or re-linked into the slot of its real deadline, so every tick costs O(1)
+// per entry in its slot, independent of how many entries the wheel holds.
+class TimerWheel
+{
+public:
+    class Entry
+    {
+    public:
+        Entry() = default;
+        Entry(const Entry &) = delete;
+        Entry &operator=(const Entry &) = delete;
+
+    private:
+        friend class TimerWheel;
+
+        Entry *prev_{nullptr};
+        Entry *next_{nullptr};
+        std::atomic<std::uint32_t> last_active_{0};
+    };
+
+    explicit TimerWheel(std::chrono::milliseconds timeout,
+                        std::chrono::milliseconds tick = std::chrono::seconds(1));
+
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    // Schedules `entry` to expire one timeout from now. The entry must not be linked.
+    void add(Entry &entry);
+
+    // Unlinks `entry`; does nothing if it already expired or was never added.
+    void remove(Entry &entry);
+
+    // Records activity on a linked entry. Lock-free, so any thread may call it.
+    void touch(Entry &entry);
+
+    // Whether `entry` has seen no activity for the whole timeout. Owners use it to
+    // confirm an expiry once they get to act on it.
+    bool idle(const Entry &entry) const;
+
+    // Moves the wheel one tick forward and unlinks every entry that has been idle for
+    // the whole timeout, passing it to `on_expired(Entry &)`. The handler runs with
+    // the wheel locked and must not call back into it.
+    template <typename Handler> void advance(Handler &&on_expired);
+
+    std::chrono::milliseconds tick() const;
+    std::size_t size() const;
+
+private:
+    static void link(Entry &head, Entry &entry);
+    static void unlink(Entry &entry);
+    Entry &slot_for(std::uint32_t tick);
+
+    std::chrono::milliseconds tick_;
+    std::uint32_t timeout_ticks_;
+    std::uint32_t slot_mask_;
+    // Slot heads are sentinels of circular lists, so linking never branches.
+    std::vector<Entry> slots_;
+    std::atomic<std::uint32_t> current_tick_{0};
+    std::size_t size_{0};
+    mutable std::mutex mutex_;
+};
+
+template <typename Handler> void TimerWheel::advance(Handler &&on_expired)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::uint32_t now = current_tick_.load(std::memory_order_relaxed) + 1;
+    current_tick_.store(now, std::memory_order_relaxed);
+
+    Entry &head = slot_for(now);
+    Entry *entry = head.next_;
+    while (entry != &head)
+    {
+        Entry *next = entry->next_;
+        const std::uint32_t last_active = entry->last_active_.load(std::memory_order_relaxed);
+
+        unlink(*entry);
+        if (now - last_active >= timeout_ticks_)
+        {
+            --size_;
+            on_expired(*entry);
+        }
+        else
+        {
+            // The wheel has more slots than the timeout has ticks, so the real
+            // deadline always lands in a later slot than this one.
+            link(slot_for(last_active + timeout_ticks_), *entry);
+        }
+        entry = next;
+    }
+}
+} // namespace ds
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "AnomalyDetector.hpp"
+#include "AnomalySink.hpp"
+#include "InputTokenizer.hpp"
+
+namespace ds
+{
+// Fire-and-forget ingestion: each datagram carries one or more vectors, either as
+// text lines or as binary frames after the "DSB1" magic. Nothing is sent back to
+// the producer; anomalies go to the configured sink instead.
+class UdpServer
+{
+public:
+    UdpServer(unsigned short port, AnomalyDetector &detector, std::size_t expected_input_size, IAnomalySink &sink);
+    ~UdpServer();
+
+    UdpServer(const UdpServer &) = delete;
+    UdpServer &operator=(const UdpServer &) = delete;
+
+    void start();
+
+private:
+    static constexpr std::size_t kBatchSize = 32;
+    static constexpr std::size_t kMaxDatagramSize = 64 * 1024;
+
+    // Where a scored row came from, so anomalies can name their producer.
+    struct RowOrigin
+    {
+        std::uint32_t datagram;
+        std::optional<std::uint64_t> request_id;
+    };
+
+    void run();
+    void collect_text_rows(std::uint32_t datagram, std::string_view text);
+    void collect_binary_rows(std::uint32_t datagram, std::string_view payload);
+    std::span<float> next_row();
+    void score_rows();
+
+    int fd_{-1};
+    unsigned short port_;
+    AnomalyDetector &detector_;
+    std::size_t expected_input_size_;
+    IAnomalySink &sink_;
+
+    std::vector<char> buffers_;
+    std::array<iovec, kBatchSize> iovecs_{};
+    std::array<sockaddr_in, kBatchSize> peers_{};
+    std::array<mmsghdr, kBatchSize> messages_{};
+
+    TokenizedText tokenized_;
+    std::vector<float> batch_inputs_;
+    std::vector<DetectionResult> batch_results_;
+    std::vector<RowOrigin> row_origins_;
+
+    std::atomic<bool> stop_requested_{false};
+    std::thread thread_;
+};
+} // namespace ds
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "AnomalyDetector.hpp"
+#include "InferenceScheduler.hpp"
+#include "ListenerHandoff.hpp"
+
+namespace ds
+{
+// io_uring transport for the TCP (and optional Unix socket) front end. Each worker
+// thread owns one ring with a registered receive buffer group; connections are
+// accepted and read with multishot requests, and every thread batches the
+// submissions and completions of all its connections into one io_uring_enter call.
+// Sessions speak the same protocols as TcpServer through SessionProtocol.
+class UringServer
+{
+public:
+    UringServer(std::uint16_t port,
+                AnomalyDetector &detector,
+                InferenceScheduler &scheduler,
+                std::size_t expected_input_size,
+                std::size_t worker_threads,
+                const std::string &unix_socket_path = {},
+                std::chrono::microseconds busy_poll = {},
+                std::chrono::seconds idle_timeout = {},
+                Listeners inherited = {});
+    // Closes the listeners and, unless they were handed to a replacement, removes
+    // the Unix socket file.
+    ~UringServer();
+
+    UringServer(const UringServer &) = delete;
+    UringServer &operator=(const UringServer &) = delete;
+
+    // True when the running kernel supports everything this transport needs.
+    static bool supported();
+
+    void run();
+
+    Listeners listeners() const;
+
+    // Same contract as TcpServer::drain(): every worker stops accepting, finishes the
+    // current request of each connection and returns from run() once none are left.
+    void drain(std::chrono::seconds deadline);
+
+private:
+    std::uint16_t port_;
+    int listen_fd_{-1};
+    int local_listen_fd_{-1};
+    std::string unix_socket_path_;
+    AnomalyDetector &detector_;
+    InferenceScheduler &scheduler_;
+    std::size_t expected_input_size_;
+    std::size_t worker_threads_;
+    std::chrono::microseconds busy_poll_;
+    std::chrono::seconds idle_timeout_;
+    int drain_fd_{-1};
+    std::atomic<std::int64_t> drain_seconds_{0};
+    // Set by drain(): the socket file then belongs to the replacement engine.
+    std::atomic<bool> handed_off_{false};
+};
+} // namespace ds
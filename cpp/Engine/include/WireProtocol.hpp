@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "AnomalyDetector.hpp"
+#include "ReplyBuffer.hpp"
+
+namespace ds::wire
+{
+// A client opts into binary framing by sending these four bytes first; the
+// engine echoes them back to confirm. Any other first byte keeps text mode.
+constexpr std::array<char, 4> kBinaryMagic{'D', 'S', 'B', '1'};
+
+// Frame header: u8 type, u8 encoding, u16 flags, u32 element count (all little-endian),
+// followed by a u64 request id when kFlagTagged is set, then `count` little-endian values
+// in the frame's encoding. Scaled integer encodings put a float32 scale in front of the
+// values; each value decodes to `integer * scale`.
+constexpr std::size_t kFrameHeaderSize = 8;
+constexpr std::size_t kRequestIdSize = 8;
+constexpr std::size_t kScaleSize = 4;
+constexpr std::uint32_t kMaxFrameValues = 16 * 1024;
+
+// Tagged frames are answered in completion order and their reply carries the id back.
+constexpr std::uint16_t kFlagTagged = 0x0001;
+
+// Batch frames carry `count` rows of the engine's input size and cannot be tagged.
+// The header is followed by a u32 body size and the body: all rows' values in the
+// frame's encoding behind one shared scale, stored as a raw LZ4 block when
+// kFlagCompressed is set.
+constexpr std::uint16_t kFlagCompressed = 0x0002;
+constexpr std::size_t kBodySizeSize = 4;
+constexpr std::uint32_t kMaxBatchRows = 4096;
+constexpr std::size_t kMaxBatchBodySize = 4 * 1024 * 1024;
+
+// Reply: u8 status followed by the reconstruction MSE as a little-endian float64.
+// Replies to tagged frames set kReplyTaggedBit in the status byte and insert the
+// u64 request id between the status and the MSE.
+constexpr std::size_t kReplySize = 9;
+constexpr std::size_t kTaggedReplySize = kReplySize + kRequestIdSize;
+constexpr std::uint8_t kReplyTaggedBit = 0x80;
+
+// Reply to a batch frame: u8 kReplyBatchMarker, u8 zero, u16 flags, u32 rows, u32 body
+// size, then a body of one u8 status and float64 MSE per row, LZ4-compressed (and
+// flagged kFlagCompressed) when the request was.
+constexpr std::uint8_t kReplyBatchMarker = 0x40;
+constexpr std::size_t kBatchReplyHeaderSize = 8 + kBodySizeSize;
+
+enum class FrameType : std::uint8_t
+{
+    Evaluate = 1,
+    EvaluateBatch = 2
+};
+
+enum class Encoding : std::uint8_t
+{
+    Float32 = 0,
+    Float16 = 1, // IEEE 754 binary16
+    Int16 = 2,   // scaled
+    Int8 = 3     // scaled
+};
+
+enum class ReplyStatus : std::uint8_t
+{
+    Ok = 0,
+    Anomaly = 1,
+    Error = 2
+};
+
+struct FrameHeader
+{
+    FrameType type;
+    Encoding encoding;
+    std::uint16_t flags;
+    std::uint32_t count;
+
+    // Whether the engine can score this frame: a known type and encoding, flags the
+    // type allows and at most kMaxFrameValues values or kMaxBatchRows rows.
+    bool valid() const;
+    bool tagged() const;
+    bool batch() const;
+    bool compressed() const;
+    // Bytes between the header and the values of an Evaluate frame; only the body
+    // size field for a batch frame, whose body follows it.
+    std::size_t payload_size() const;
+};
+
+enum class MagicMatch
+{
+    Incomplete,
+    Binary,
+    Text
+};
+
+MagicMatch match_binary_magic(std::string_view prefix);
+
+FrameHeader decode_frame_header(const char *data);
+std::uint64_t decode_request_id(const char *data);
+std::uint32_t decode_body_size(const char *data);
+
+// Uncompressed body size of a batch of `rows` rows with `width` values each.
+std::size_t batch_body_size(Encoding encoding, std::size_t rows, std::size_t width);
+// Bytes one value takes in `encoding`; 0 for encodings this engine does not know.
+std::size_t encoded_value_size(Encoding encoding);
+bool scaled_encoding(Encoding encoding);
+
+// Expands `output.size()` packed values to float32. `scale` only applies to the
+// scaled integer encodings. Uses F16C/AVX2 when the CPU has them.
+void decode_values(Encoding encoding, const char *data, float scale, std::span<float> output);
+
+// decode_values() with the kernels of the named instruction set ("avx2", "f16c" or
+// "scalar") instead of the ones selected at runtime, so tests can compare every path.
+// "f16c" only vectorizes binary16. Returns false when this CPU lacks it.
+bool decode_values_with(std::string_view isa_name,
+                        Encoding encoding,
+                        const char *data,
+                        float scale,
+                        std::span<float> output);
+
+// Decodes the values of a valid frame; `data` points just past the request id.
+void decode_frame_values(const FrameHeader &header, const char *data, std::span<float> output);
+
+void append_reply(ReplyBuffer &out, ReplyStatus status, double mse);
+void append_tagged_reply(ReplyBuffer &out, std::uint64_t request_id, ReplyStatus status, double mse);
+void append_batch_reply(ReplyBuffer &out, std::span<const DetectionResult> results, bool compressed);
+ReplyStatus to_reply_status(DetectionStatus status);
+} // namespace ds::wire
@@ -1,16 +1,30 @@
+#include <unistd.h>
+
+#include <chrono>
 #include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "AnomalyDetector.hpp"
+#include "AnomalySink.hpp"
 #include "Config.hpp"
 #include "ConfigLoader.hpp"
 #include "GrpcServer.hpp"
+#include "InferenceScheduler.hpp"
 #include "InferenceBackendFactory.hpp"
+#include "ListenerHandoff.hpp"
 #include "Logger.hpp"
+#include "RequestMetrics.hpp"
+#include "ShardedTcpServer.hpp"
+#include "ShmServer.hpp"
 #include "TcpServer.hpp"
+#include "UdpServer.hpp"
+#include "UringServer.hpp"
 
 namespace ds
 {
@@ -38,6 +52,153 @@ std::string resolve_protocol_name()
 
     return std::string(env_protocol);
 }
+
+std::uint16_t resolve_grpc_port(std::uint16_t default_port)
+{
+    const char *env_port = std::getenv("DATASENTINEL_GRPC_PORT");
+    if (env_port == nullptr)
+    {
+        return default_port;
+    }
+
+    const int port = std::stoi(env_port);
+    if (port <= 0 || port > 65535)
+    {
+        throw std::runtime_error("Invalid DATASENTINEL_GRPC_PORT: " + std::string(env_port));
+    }
+
+    return static_cast<std::uint16_t>(port);
+}
+
+std::string resolve_tcp_io_name()
+{
+    const char *env_io = std::getenv("DATASENTINEL_TCP_IO");
+    if (env_io == nullptr)
+    {
+        return "asio";
+    }
+
+    return std::string(env_io);
+}
+
+std::size_t resolve_tcp_shards()
+{
+    const char *env_shards = std::getenv("DATASENTINEL_TCP_SHARDS");
+    if (env_shards == nullptr)
+    {
+        // Sharded listeners are opt-in.
+        return 0;
+    }
+
+    const int shards = std::stoi(env_shards);
+    if (shards < 0)
+    {
+        throw std::runtime_error("Invalid DATASENTINEL_TCP_SHARDS: " + std::string(env_shards));
+    }
+
+    return static_cast<std::size_t>(shards);
+}
+
+std::chrono::microseconds resolve_busy_poll(std::uint32_t default_microseconds)
+{
+    const char *env_busy_poll = std::getenv("DATASENTINEL_BUSY_POLL_US");
+    if (env_busy_poll == nullptr)
+    {
+        return std::chrono::microseconds(default_microseconds);
+    }
+
+    const int microseconds = std::stoi(env_busy_poll);
+    if (microseconds < 0)
+    {
+        throw std::runtime_error("Invalid DATASENTINEL_BUSY_POLL_US: " + std::string(env_busy_poll));
+    }
+
+    return std::chrono::microseconds(microseconds);
+}
+
+std::string resolve_unix_socket_path()
+{
+    const char *env_path = std::getenv("DATASENTINEL_UNIX_SOCKET");
+    if (env_path == nullptr)
+    {
+        // Unix socket listener is opt-in.
+        return {};
+    }
+
+    return std::string(env_path);
+}
+
+std::string resolve_shm_name()
+{
+    const char *env_name = std::getenv("DATASENTINEL_SHM_NAME");
+    if (env_name == nullptr)
+    {
+        // Shared memory transport is opt-in.
+        return {};
+    }
+
+    return std::string(env_name);
+}
+
+unsigned short resolve_udp_port()
+{
+    const char *env_port = std::getenv("DATASENTINEL_UDP_PORT");
+    if (env_port == nullptr)
+    {
+        // UDP ingestion is opt-in.
+        return 0;
+    }
+
+    const int port = std::stoi(env_port);
+    if (port <= 0 || port > 65535)
+    {
+        throw std::runtime_error("Invalid DATASENTINEL_UDP_PORT: " + std::string(env_port));
+    }
+
+    return static_cast<unsigned short>(port);
+}
+
+std::string resolve_handoff_socket_path()
+{
+    const char *env_path = std::getenv("DATASENTINEL_HANDOFF_SOCKET");
+    if (env_path == nullptr)
+    {
+        // Listener handoff between engine processes is opt-in.
+        return {};
+    }
+
+    return std::string(env_path);
+}
+
+// Scores one request and one full batch of zeros so the backend's lazy allocations and
+// kernel selection happen before the first client is served, not during it.
+void warm_up(AnomalyDetector &detector, std::size_t input_size, std::size_t batch_rows)
+{
+    const auto started = std::chrono::steady_clock::now();
+
+    detector.evaluate(std::vector<float>(input_size, 0.0F));
+    if (batch_rows > 1)
+    {
+        const std::vector<float> inputs(input_size * batch_rows, 0.0F);
+        std::vector<DetectionResult> results(batch_rows);
+        detector.evaluate_batch(inputs, results);
+    }
+
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    ds::log::info("Backend warmed up in " + std::to_string(elapsed.count()) + " ms");
+}
+
+std::string resolve_anomaly_sink_spec()
+{
+    const char *env_sink = std::getenv("DATASENTINEL_ANOMALY_SINK");
+    if (env_sink == nullptr)
+    {
+        return "log";
+    }
+
+    return std::string(env_sink);
+}
 } // namespace
 } // namespace ds
 
@@ -49,30 +210,215 @@ int main()
         const std::string backend_name = ds::resolve_backend_name();
         const std::string protocol_name = ds::resolve_protocol_name();
         const ds::BackendKind backend_kind = ds::parse_backend_kind(backend_name);
+        const bool serve_tcp = protocol_name == "tcp" || protocol_name == "both";
+        const bool serve_grpc = protocol_name == "grpc" || protocol_name == "both";
+        if (!serve_tcp && !serve_grpc)
+        {
+            throw std::runtime_error("Unsupported DATASENTINEL_PROTOCOL: " + protocol_name +
+                                     ". Supported values: tcp, grpc, both");
+        }
 
-        auto backend = ds::create_backend(backend_kind, config.model_path);
         const double threshold = ds::load_threshold(config.runtime_config_path);
+        const std::size_t tcp_shards = serve_tcp ? ds::resolve_tcp_shards() : 0;
+        const std::string shm_name = ds::resolve_shm_name();
+        const unsigned short udp_port = ds::resolve_udp_port();
+
+        // TCP shards load their own backends, so the shared backend, detector and
+        // scheduler are only built when another front end scores through them.
+        const bool shared_backend = tcp_shards == 0 || serve_grpc || !shm_name.empty() || udp_port != 0;
+        std::unique_ptr<ds::IInferenceBackend> backend;
+        std::optional<ds::AnomalyDetector> detector;
+        if (shared_backend)
+        {
+            backend = ds::create_backend(backend_kind, config.model_path);
+            ds::log::info("Backend: " + backend->backend_name());
+            ds::log::info("Expected input size: " + std::to_string(backend->expected_input_size()));
 
-        ds::log::info("Backend: " + backend->backend_name());
+            detector.emplace(*backend, threshold);
+            ds::warm_up(*detector, backend->expected_input_size(), config.inference_max_batch_rows);
+        }
         ds::log::info("Protocol: " + protocol_name);
         ds::log::info("Threshold: " + std::to_string(threshold));
-        ds::log::info("Expected input size: " + std::to_string(backend->expected_input_size()));
 
-        ds::AnomalyDetector detector(*backend, threshold);
-        if (protocol_name == "grpc")
+        // With a handoff socket, a running engine hands its listeners over to this one
+        // and drains; without a running engine this one starts as usual.
+        const std::string handoff_path = ds::resolve_handoff_socket_path();
+        std::optional<ds::ListenerTakeover> takeover;
+        ds::Listeners inherited;
+        if (!handoff_path.empty())
         {
-            ds::GrpcServer server(config.server_port, detector, backend->expected_input_size());
-            server.run();
+            if (!shm_name.empty() || udp_port != 0)
+            {
+                throw std::runtime_error("DATASENTINEL_HANDOFF_SOCKET is not supported with the UDP or shared "
+                                         "memory transports");
+            }
+            if (tcp_shards > 0)
+            {
+                throw std::runtime_error("DATASENTINEL_HANDOFF_SOCKET is not supported with DATASENTINEL_TCP_SHARDS");
+            }
+
+            takeover.emplace(handoff_path);
+            inherited = takeover->listeners();
+            if (inherited.local >= 0 && ds::resolve_unix_socket_path().empty())
+            {
+                ::close(inherited.local);
+                inherited.local = -1;
+            }
+        }
+        const std::chrono::seconds handoff_drain(config.handoff_drain_seconds);
+
+        // The shared memory transport runs next to whichever network protocol is selected.
+        std::unique_ptr<ds::ShmServer> shm_server;
+        if (!shm_name.empty())
+        {
+            shm_server = std::make_unique<ds::ShmServer>(shm_name,
+                                                         *detector,
+                                                         backend->expected_input_size(),
+                                                         std::chrono::microseconds(config.shm_spin_microseconds));
+            shm_server->start();
+        }
+
+        std::unique_ptr<ds::IAnomalySink> anomaly_sink;
+        std::unique_ptr<ds::UdpServer> udp_server;
+        if (udp_port != 0)
+        {
+            anomaly_sink = ds::create_anomaly_sink(ds::resolve_anomaly_sink_spec());
+            udp_server = std::make_unique<ds::UdpServer>(udp_port,
+                                                         *detector,
+                                                         backend->expected_input_size(),
+                                                         *anomaly_sink);
+            udp_server->start();
+        }
+
+        const ds::InFlightLimits in_flight_limits{.per_connection = config.max_in_flight_per_connection,
+                                                  .total = config.max_in_flight_total};
+        std::unique_ptr<ds::MetricsReporter> metrics_reporter;
+        if (config.metrics_log_interval_seconds > 0)
+        {
+            metrics_reporter =
+                std::make_unique<ds::MetricsReporter>(std::chrono::seconds(config.metrics_log_interval_seconds));
+            metrics_reporter->start();
+        }
+
+        // One scheduler and backend serve every front end, so gRPC and TCP requests
+        // are batched together.
+        std::optional<ds::InferenceScheduler> scheduler;
+        if (shared_backend)
+        {
+            scheduler.emplace(*detector,
+                              config.inference_worker_threads,
+                              in_flight_limits,
+                              config.inference_max_batch_rows);
         }
-        else if (protocol_name == "tcp")
+
+        std::unique_ptr<ds::GrpcServer> grpc_server;
+        if (serve_grpc)
+        {
+            // gRPC keeps the main port on its own and moves aside when TCP is served too.
+            grpc_server = std::make_unique<ds::GrpcServer>(
+                ds::resolve_grpc_port(serve_tcp ? config.grpc_port : config.server_port),
+                *scheduler,
+                backend->expected_input_size(),
+                config.grpc_completion_queues,
+                config.grpc_calls_per_queue);
+            grpc_server->start();
+        }
+
+        // Once this engine serves, the one it took over from may drain; from then on
+        // it offers its own listeners to the next replacement the same way.
+        const auto serve = [&](ds::Listeners listeners, const auto &drain, const auto &run) {
+            if (takeover)
+            {
+                takeover->confirm();
+            }
+
+            std::unique_ptr<ds::ListenerOffer> offer;
+            if (!handoff_path.empty())
+            {
+                offer = std::make_unique<ds::ListenerOffer>(handoff_path, listeners, [&] {
+                    drain();
+                    if (grpc_server)
+                    {
+                        grpc_server->shutdown(handoff_drain);
+                    }
+                });
+                offer->start();
+            }
+
+            run();
+        };
+
+        if (!serve_tcp)
         {
-            ds::TcpServer server(config.server_port, detector, backend->expected_input_size());
+            // gRPC sets SO_REUSEPORT, so the replacement binds next to this engine
+            // instead of taking a listener over.
+            serve({}, [] {}, [&] { grpc_server->wait(); });
+        }
+        else if (tcp_shards > 0)
+        {
+            if (!ds::resolve_unix_socket_path().empty())
+            {
+                throw std::runtime_error("DATASENTINEL_UNIX_SOCKET is not supported with DATASENTINEL_TCP_SHARDS");
+            }
+
+            // Each shard loads its own backend so no inference state is shared across cores.
+            ds::ShardedTcpServer server(
+                config.server_port,
+                tcp_shards,
+                [&] {
+                    auto shard_backend = ds::create_backend(backend_kind, config.model_path);
+                    ds::AnomalyDetector shard_detector(*shard_backend, threshold);
+                    ds::warm_up(shard_detector, shard_backend->expected_input_size(), 1);
+                    return shard_backend;
+                },
+                threshold,
+                in_flight_limits,
+                ds::resolve_busy_poll(config.tcp_busy_poll_microseconds),
+                std::chrono::seconds(config.idle_timeout_seconds));
             server.run();
         }
         else
         {
-            throw std::runtime_error("Unsupported DATASENTINEL_PROTOCOL: " + protocol_name +
-                                     ". Supported values: tcp, grpc");
+            const std::string io_name = ds::resolve_tcp_io_name();
+            if (io_name != "asio" && io_name != "io_uring")
+            {
+                throw std::runtime_error("Unsupported DATASENTINEL_TCP_IO: " + io_name +
+                                         ". Supported values: asio, io_uring");
+            }
+
+            if (io_name == "io_uring" && ds::UringServer::supported())
+            {
+                ds::log::info("TCP I/O: io_uring");
+                ds::UringServer server(config.server_port,
+                                       *detector,
+                                       *scheduler,
+                                       backend->expected_input_size(),
+                                       config.tcp_worker_threads,
+                                       ds::resolve_unix_socket_path(),
+                                       ds::resolve_busy_poll(config.tcp_busy_poll_microseconds),
+                                       std::chrono::seconds(config.idle_timeout_seconds),
+                                       inherited);
+                serve(server.listeners(), [&] { server.drain(handoff_drain); }, [&] { server.run(); });
+            }
+            else
+            {
+                if (io_name == "io_uring")
+                {
+                    ds::log::error("Kernel lacks multishot io_uring support, falling back to asio");
+                }
+
+                ds::log::info("TCP I/O: asio");
+                ds::TcpServer server(config.server_port,
+                                     *detector,
+                                     *scheduler,
+                                     backend->expected_input_size(),
+                                     config.tcp_worker_threads,
+                                     ds::resolve_unix_socket_path(),
+                                     ds::resolve_busy_poll(config.tcp_busy_poll_microseconds),
+                                     std::chrono::seconds(config.idle_timeout_seconds),
+                                     inherited);
+                serve(server.listeners(), [&] { server.drain(handoff_drain); }, [&] { server.run(); });
+            }
         }
     }
     catch (const std::exception &ex)
@@ -6,8 +6,8 @@ namespace ds
 {
 namespace
 {
-double compute_mse(const std::vector<float> &actual,
-                   const std::vector<float> &reconstructed)
+double compute_mse(std::span<const float> actual,
+                   std::span<const float> reconstructed)
 {
     if (actual.size() != reconstructed.size())
     {
@@ -25,9 +25,9 @@ double compute_mse(const std::vector<float> &actual,
 }
 } // namespace
 
-std::string DetectionResult::response_line() const
+std::string_view DetectionResult::response_line() const
 {
-    return (status == DetectionStatus::Anomaly) ? "ANOMALY\n" : "OK\n";
+    return (status == DetectionStatus::Anomaly) ? std::string_view("ANOMALY\n") : std::string_view("OK\n");
 }
 
 AnomalyDetector::AnomalyDetector(IInferenceBackend &backend, double threshold)
@@ -39,8 +39,37 @@ AnomalyDetector::AnomalyDetector(IInferenceBackend &backend, double threshold)
 DetectionResult AnomalyDetector::evaluate(const std::vector<float> &input)
 {
     const auto reconstructed = backend_.reconstruct(input);
-    const double mse = compute_mse(input, reconstructed);
+    return classify(compute_mse(input, reconstructed));
+}
+
+void AnomalyDetector::evaluate_batch(std::span<const float> inputs, std::span<DetectionResult> results)
+{
+    if (results.empty())
+    {
+        return;
+    }
+
+    const std::size_t row_size = inputs.size() / results.size();
+    if (row_size == 0 || row_size * results.size() != inputs.size())
+    {
+        throw std::runtime_error("Batch input does not match the number of result slots");
+    }
+
+    // Reused per thread so steady-state batches do not allocate.
+    thread_local std::vector<float> reconstructed;
+    reconstructed.resize(inputs.size());
+    backend_.reconstruct_batch(inputs, reconstructed);
 
+    for (std::size_t row = 0; row < results.size(); ++row)
+    {
+        const std::size_t offset = row * row_size;
+        results[row] = classify(compute_mse(inputs.subspan(offset, row_size),
+                                            std::span<const float>(reconstructed).subspan(offset, row_size)));
+    }
+}
+
+DetectionResult AnomalyDetector::classify(double mse) const
+{
     return DetectionResult{
         .mse = mse,
         .status = (mse > threshold_) ? DetectionStatus::Anomaly : DetectionStatus::Ok,
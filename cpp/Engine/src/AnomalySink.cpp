@@ -0,0 +1,112 @@
+#include "AnomalySink.hpp"
+
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "Logger.hpp"
+
+namespace ds
+{
+namespace
+{
+constexpr std::string_view kUdpSinkPrefix = "udp:";
+} // namespace
+
+std::string format_anomaly_report(const AnomalyReport &report)
+{
+    std::string line = "ANOMALY source=" + report.source;
+    if (report.request_id)
+    {
+        line += " id=" + std::to_string(*report.request_id);
+    }
+
+    line += " mse=" + std::to_string(report.mse);
+    return line;
+}
+
+void LogAnomalySink::report(const AnomalyReport &report)
+{
+    ds::log::info(format_anomaly_report(report));
+}
+
+UdpAnomalySink::UdpAnomalySink(const std::string &host, const std::string &port)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    addrinfo *addresses = nullptr;
+    const int rc = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses);
+    if (rc != 0)
+    {
+        throw std::runtime_error("Failed to resolve anomaly sink " + host + ":" + port + ": " + ::gai_strerror(rc));
+    }
+
+    for (const addrinfo *address = addresses; address != nullptr; address = address->ai_next)
+    {
+        fd_ = ::socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+        if (fd_ < 0)
+        {
+            continue;
+        }
+
+        // Connecting a datagram socket only fixes the destination; nothing is sent.
+        if (::connect(fd_, address->ai_addr, address->ai_addrlen) == 0)
+        {
+            break;
+        }
+
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    ::freeaddrinfo(addresses);
+    if (fd_ < 0)
+    {
+        throw std::runtime_error("Failed to open anomaly sink " + host + ":" + port + ": " + std::strerror(errno));
+    }
+}
+
+UdpAnomalySink::~UdpAnomalySink()
+{
+    ::close(fd_);
+}
+
+void UdpAnomalySink::report(const AnomalyReport &report)
+{
+    const std::string line = format_anomaly_report(report) + '\n';
+    // Best effort, like the datagrams that produced the anomaly.
+    if (::send(fd_, line.data(), line.size(), MSG_DONTWAIT) < 0)
+    {
+        ds::log::error(std::string("Failed to forward anomaly report: ") + std::strerror(errno));
+    }
+}
+
+std::unique_ptr<IAnomalySink> create_anomaly_sink(const std::string &spec)
+{
+    if (spec.empty() || spec == "log")
+    {
+        return std::make_unique<LogAnomalySink>();
+    }
+
+    if (spec.starts_with(kUdpSinkPrefix))
+    {
+        const std::string target = spec.substr(kUdpSinkPrefix.size());
+        const std::size_t colon = target.rfind(':');
+        if (colon == std::string::npos || colon == 0 || colon + 1 == target.size())
+        {
+            throw std::runtime_error("Invalid anomaly sink " + spec + ". Expected udp:<host>:<port>");
+        }
+
+        return std::make_unique<UdpAnomalySink>(target.substr(0, colon), target.substr(colon + 1));
+    }
+
+    throw std::runtime_error("Unsupported DATASENTINEL_ANOMALY_SINK: " + spec +
+                             ". Supported values: log, udp:<host>:<port>");
+}
+} // namespace ds
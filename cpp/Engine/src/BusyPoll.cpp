@@ -0,0 +1,61 @@
+#include "BusyPoll.hpp"
+
+#include <sys/socket.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "Logger.hpp"
+
+namespace ds
+{
+void run_busy_polling(boost::asio::io_context &io_context, std::chrono::microseconds spin)
+{
+    if (spin.count() <= 0)
+    {
+        io_context.run();
+        return;
+    }
+
+    auto last_activity = std::chrono::steady_clock::now();
+    while (!io_context.stopped())
+    {
+        if (io_context.poll() > 0)
+        {
+            last_activity = std::chrono::steady_clock::now();
+            continue;
+        }
+
+        if (std::chrono::steady_clock::now() - last_activity < spin)
+        {
+            continue;
+        }
+
+        if (io_context.run_one() == 0)
+        {
+            return;
+        }
+        last_activity = std::chrono::steady_clock::now();
+    }
+}
+
+void enable_socket_busy_poll(int socket_fd, std::chrono::microseconds spin)
+{
+    static std::atomic<bool> reported{false};
+
+    const int microseconds = static_cast<int>(spin.count());
+    if (microseconds <= 0)
+    {
+        return;
+    }
+
+    if (::setsockopt(socket_fd, SOL_SOCKET, SO_BUSY_POLL, &microseconds, sizeof(microseconds)) != 0 &&
+        !reported.exchange(true))
+    {
+        ds::log::error(std::string("SO_BUSY_POLL unavailable, spinning in user space only: ") +
+                       std::strerror(errno));
+    }
+}
+} // namespace ds
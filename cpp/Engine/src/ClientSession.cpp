@@ -2,73 +2,370 @@
 
 #include <boost/asio.hpp>
 
-#include <string>
+#include <array>
+#include <string_view>
+#include <utility>
 
-#include "InputParser.hpp"
 #include "Logger.hpp"
 
-using boost::asio::ip::tcp;
-
 namespace ds
 {
-ClientSession::ClientSession(tcp::socket &socket,
+namespace
+{
+// Large reads let a pipelining client deliver many requests per syscall.
+constexpr std::size_t kReadChunkSize = 64 * 1024;
+// Upper bound on reply chunks handed to one write; more wait for the next flush.
+constexpr std::size_t kMaxWriteSegments = 64;
+} // namespace
+
+ClientSession::ClientSession(Socket socket,
+                             std::string peer,
                              AnomalyDetector &detector,
-                             std::size_t expected_input_size)
-    : socket_(socket),
-      detector_(detector),
-      expected_input_size_(expected_input_size)
+                             InferenceScheduler &scheduler,
+                             std::size_t expected_input_size,
+                             TimerWheel *idle_timer)
+    : socket_(std::move(socket)),
+      peer_(std::move(peer)),
+      scheduler_(scheduler),
+      protocol_(detector,
+                expected_input_size,
+                [this](std::uint64_t request_id, std::vector<float> values) {
+                    dispatch_tagged(request_id, std::move(values));
+                },
+                [&scheduler](std::size_t in_flight) { return scheduler.admits(in_flight); }),
+      idle_timer_(idle_timer)
 {
+    count_connection_opened();
 }
 
-void ClientSession::run()
+ClientSession::~ClientSession()
 {
-    ds::log::info("Client connected: " + socket_.remote_endpoint().address().to_string());
+    if (idle_timer_ != nullptr)
+    {
+        idle_timer_->remove(*this);
+    }
+    count_connection_closed();
+}
 
-    boost::asio::streambuf buffer;
+std::shared_ptr<ClientSession> ClientSession::create(Socket socket,
+                                                     std::string peer,
+                                                     AnomalyDetector &detector,
+                                                     InferenceScheduler &scheduler,
+                                                     std::size_t expected_input_size,
+                                                     TimerWheel *idle_timer)
+{
+    SlabPtr<ClientSession> session = make_slab<ClientSession>(
+        std::move(socket), std::move(peer), detector, scheduler, expected_input_size, idle_timer);
+    return std::shared_ptr<ClientSession>(session.release(), SlabDelete<ClientSession>{},
+                                          SlabAllocator<ClientSession>{});
+}
 
-    while (socket_.is_open())
+void ClientSession::start()
+{
+    ds::log::info("Client connected: " + peer_);
+
+    boost::system::error_code ec;
+    socket_.non_blocking(true, ec);
+    if (ec)
     {
-        try
+        ds::log::error(ec.message());
+        close();
+        return;
+    }
+
+    if (idle_timer_ != nullptr)
+    {
+        idle_timer_->add(*this);
+    }
+
+    // Reads process input in place, so even the first one must run on the strand
+    // that later completions of this session are delivered to.
+    read_later();
+}
+
+void ClientSession::drain()
+{
+    boost::asio::post(socket_.get_executor(), [self = shared_from_this()] {
+        if (self->closed_)
         {
-            buffer.consume(buffer.size());
-            boost::asio::read_until(socket_, buffer, "\n");
+            return;
+        }
+
+        self->draining_ = true;
+        self->close_when_drained();
+    });
+}
+
+void ClientSession::stop()
+{
+    boost::asio::post(socket_.get_executor(), [self = shared_from_this()] { self->close(); });
+}
+
+void ClientSession::expire_idle(TimerWheel::Entry &entry)
+{
+    // A session whose last reference is already gone is being destroyed.
+    if (auto self = static_cast<ClientSession &>(entry).weak_from_this().lock())
+    {
+        boost::asio::post(self->socket_.get_executor(), [self] { self->on_idle_expired(); });
+    }
+}
+
+void ClientSession::on_idle_expired()
+{
+    if (closed_)
+    {
+        return;
+    }
 
-            std::istream input_stream(&buffer);
-            std::string raw_data;
-            std::getline(input_stream, raw_data);
+    // Quiet while requests are running or replies are still going out is not idle,
+    // and input may have arrived after the wheel picked this session.
+    if (protocol_.tagged_in_flight() > 0 || writing_ || !idle_timer_->idle(*this))
+    {
+        idle_timer_->add(*this);
+        return;
+    }
 
-            ds::log::info("Received raw: " + raw_data);
+    ds::log::info("Closing idle connection: " + peer_);
+    close();
+}
 
-            const auto values = parse_input_line(raw_data);
+bool ClientSession::read_some()
+{
+    thread_local std::array<char, kReadChunkSize> read_buffer;
 
-            if (values.size() != expected_input_size_)
+    boost::system::error_code ec;
+    const std::size_t bytes_read = socket_.read_some(boost::asio::buffer(read_buffer), ec);
+    if (ec == boost::asio::error::would_block)
+    {
+        reading_ = true;
+        socket_.async_wait(Socket::wait_read, [self = shared_from_this()](const boost::system::error_code &wait_error) {
+            self->reading_ = false;
+            if (self->closed_)
             {
-                ds::log::error("Invalid input size. Expected " + std::to_string(expected_input_size_) +
-                               ", got " + std::to_string(values.size()));
+                return;
+            }
+
+            if (wait_error)
+            {
+                ds::log::error(wait_error.message());
+                self->close();
+                return;
+            }
+
+            self->maybe_read();
+        });
+        return false;
+    }
+
+    if (ec)
+    {
+        if (ec != boost::asio::error::eof)
+        {
+            ds::log::error(ec.message());
+            close();
+            return false;
+        }
+
+        // Let tagged requests that are still running deliver their replies first.
+        read_closed_ = true;
+        close_when_drained();
+        return false;
+    }
+
+    if (idle_timer_ != nullptr)
+    {
+        idle_timer_->touch(*this);
+    }
 
-                const std::string response = "ERROR: Invalid input size\n";
-                boost::asio::write(socket_, boost::asio::buffer(response));
-                continue;
+    return process_input(std::string_view(read_buffer.data(), bytes_read));
+}
+
+bool ClientSession::process_input(std::string_view received)
+{
+    try
+    {
+        if (pending_.empty())
+        {
+            // Common case: whole requests straight out of the read buffer.
+            const std::size_t consumed = protocol_.consume(received, replies_);
+            pending_.assign(received.substr(consumed));
+        }
+        else
+        {
+            pending_.append(received);
+            pending_.erase(0, protocol_.consume(pending_, replies_));
+            if (pending_.empty())
+            {
+                pending_.shrink_to_fit();
             }
+        }
+        return true;
+    }
+    catch (const std::exception &ex)
+    {
+        ds::log::error(ex.what());
+        close();
+        return false;
+    }
+}
 
-            const auto result = detector_.evaluate(values);
-            ds::log::info("Reconstruction MSE: " + std::to_string(result.mse));
+void ClientSession::maybe_read()
+{
+    // Keep reading only once this batch of replies is on its way, so a client that
+    // never reads its replies cannot grow them without bound.
+    while (!reading_ && !writing_ && !closed_)
+    {
+        if (!scheduler_.admits(protocol_.tagged_in_flight()))
+        {
+            // complete_tagged() retries once this connection's requests drain.
+            throttle_.begin();
+            return;
+        }
+        throttle_.end();
+
+        if (protocol_.stalled())
+        {
+            // Requests held back at the limit go before anything new is read.
+            if (!process_input({}))
+            {
+                return;
+            }
+            flush();
+            continue;
+        }
 
-            const std::string response = result.response_line();
-            ds::log::info("Sending response: " + response);
+        if (draining_ && at_request_boundary())
+        {
+            close_when_drained();
+            return;
+        }
 
-            boost::asio::write(socket_, boost::asio::buffer(response));
+        if (read_closed_ || !read_some())
+        {
+            return;
         }
-        catch (const std::exception &ex)
+        flush();
+
+        // Go back through the io_context between reads so a socket that always has
+        // data cannot starve the other sessions on this thread. A reply write in
+        // flight already brings the session back here when it completes.
+        if (!writing_)
         {
-            ds::log::error(ex.what());
-            break;
+            read_later();
         }
+        return;
+    }
+}
+
+void ClientSession::read_later()
+{
+    reading_ = true;
+    boost::asio::post(socket_.get_executor(), [self = shared_from_this()] {
+        self->reading_ = false;
+        self->maybe_read();
+    });
+}
+
+void ClientSession::flush()
+{
+    if (writing_ || replies_.empty() || closed_)
+    {
+        return;
+    }
+
+    // Everything queued since the last write goes out in a single gather write.
+    writing_ = true;
+    write_segments_.clear();
+    replies_.gather(write_segments_, kMaxWriteSegments);
+
+    write_buffers_.clear();
+    for (const iovec &segment : write_segments_)
+    {
+        write_buffers_.emplace_back(segment.iov_base, segment.iov_len);
+    }
+
+    boost::asio::async_write(
+        socket_, write_buffers_,
+        [self = shared_from_this()](const boost::system::error_code &ec, std::size_t bytes_written) {
+            self->writing_ = false;
+
+            if (ec)
+            {
+                if (!self->closed_)
+                {
+                    ds::log::error(ec.message());
+                    self->close();
+                }
+                return;
+            }
+
+            self->replies_.consume(bytes_written);
+            self->maybe_read();
+            self->flush();
+            self->close_when_drained();
+        });
+}
+
+void ClientSession::dispatch_tagged(std::uint64_t request_id, std::vector<float> values)
+{
+    scheduler_.submit(
+        std::move(values),
+        [self = shared_from_this(), request_id](std::exception_ptr error, const DetectionResult &result) {
+            boost::asio::post(self->socket_.get_executor(), [self, request_id, error, result] {
+                self->complete_tagged(request_id, error, result);
+            });
+        });
+}
+
+void ClientSession::complete_tagged(std::uint64_t request_id,
+                                    std::exception_ptr error,
+                                    const DetectionResult &result)
+{
+    if (closed_)
+    {
+        return;
+    }
+
+    protocol_.complete_tagged(request_id, error, result, replies_);
+    flush();
+    maybe_read();
+    close_when_drained();
+}
+
+bool ClientSession::at_request_boundary() const
+{
+    // Requests the client already sent count too, even while still in the kernel.
+    boost::system::error_code ignored;
+    return pending_.empty() && !protocol_.stalled() && socket_.available(ignored) == 0;
+}
+
+void ClientSession::close_when_drained()
+{
+    const bool reading_done = read_closed_ || (draining_ && at_request_boundary());
+    if (reading_done && protocol_.tagged_in_flight() == 0 && !writing_ && replies_.empty())
+    {
+        close();
+    }
+}
+
+void ClientSession::close()
+{
+    if (closed_)
+    {
+        return;
+    }
+    closed_ = true;
+    throttle_.end();
+    if (idle_timer_ != nullptr)
+    {
+        idle_timer_->remove(*this);
     }
 
     if (socket_.is_open())
     {
-        socket_.close();
+        boost::system::error_code ignored;
+        socket_.shutdown(Socket::shutdown_both, ignored);
+        socket_.close(ignored);
     }
 
     ds::log::info("Client disconnected");
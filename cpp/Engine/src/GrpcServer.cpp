@@ -2,106 +2,710 @@
 
 #include <grpcpp/grpcpp.h>
 
+#include <algorithm>
+#include <exception>
+#include <optional>
+#include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "Logger.hpp"
+#include "ThreadCount.hpp"
+#include "WireProtocol.hpp"
 #include "inference.grpc.pb.h"
 
 namespace ds
 {
 namespace
 {
-class InferenceServiceImpl final : public datasentinel::v1::InferenceService::Service
+using AsyncService = datasentinel::v1::InferenceService::AsyncService;
+using EvaluateRequest = datasentinel::v1::EvaluateRequest;
+using EvaluateResponse = datasentinel::v1::EvaluateResponse;
+using EvaluateBatchRequest = datasentinel::v1::EvaluateBatchRequest;
+using EvaluateBatchResponse = datasentinel::v1::EvaluateBatchResponse;
+
+// Batch calls carry up to wire::kMaxBatchRows rows each, so fewer of them are kept.
+constexpr std::size_t kBatchCallsPerQueue = 32;
+
+// Expands the request's values to float32. Returns an error message, or an empty
+// string on success.
+template <typename Request>
+std::string decode_request_values(const Request &request, std::vector<float> &values)
 {
-public:
-    InferenceServiceImpl(AnomalyDetector &detector, std::size_t expected_input_size)
-        : detector_(detector),
-          expected_input_size_(expected_input_size)
+    if (request.encoding() == EvaluateRequest::ENCODING_FLOAT32)
+    {
+        values.assign(request.values().begin(), request.values().end());
+        return {};
+    }
+
+    // Proto enums are open, and an unknown value cast to the one-byte wire::Encoding
+    // could truncate into a known one, so it is rejected first.
+    if (!EvaluateRequest::Encoding_IsValid(request.encoding()))
     {
+        return "Unsupported encoding " + std::to_string(request.encoding());
     }
 
-    grpc::Status Evaluate(grpc::ServerContext *context,
-                          const datasentinel::v1::EvaluateRequest *request,
-                          datasentinel::v1::EvaluateResponse *response) override
+    const auto encoding = static_cast<wire::Encoding>(request.encoding());
+    const std::size_t value_size = wire::encoded_value_size(encoding);
+    const std::string &packed = request.packed_values();
+    if (value_size == 0 || packed.size() % value_size != 0)
     {
-        std::vector<float> values(request->values().begin(), request->values().end());
+        return "Malformed packed values for encoding " + std::to_string(request.encoding());
+    }
+
+    values.resize(packed.size() / value_size);
+    wire::decode_values(encoding, packed.data(), request.scale(), values);
+    return {};
+}
+
+// Decodes and checks one request, logging it like the other front ends do. Returns an
+// error message, or an empty string when `values` is ready to score.
+std::string read_request(const EvaluateRequest &request,
+                         const grpc::ServerContext &context,
+                         std::size_t expected_input_size,
+                         std::vector<float> &values)
+{
+    const std::string decode_error = decode_request_values(request, values);
+    if (!decode_error.empty())
+    {
+        return decode_error;
+    }
+
+    ds::log::debug([&] {
         std::ostringstream raw;
-        for (std::size_t i = 0; i < values.size(); ++i)
+        raw << "Client request: " << context.peer() << ", received raw:";
+        for (const float value : values)
         {
-            if (i > 0)
+            raw << ' ' << value;
+        }
+        return raw.str();
+    });
+
+    if (values.size() != expected_input_size)
+    {
+        return "Invalid input size. Expected " + std::to_string(expected_input_size) + ", got " +
+               std::to_string(values.size());
+    }
+    return {};
+}
+
+std::string inference_error(std::exception_ptr error)
+{
+    try
+    {
+        std::rethrow_exception(error);
+    }
+    catch (const std::exception &ex)
+    {
+        return std::string("Inference failed: ") + ex.what();
+    }
+    catch (...)
+    {
+        return "Inference failed";
+    }
+}
+
+template <typename Response>
+void set_error(Response &response, const std::string &message)
+{
+    ds::log::error(message);
+    response.set_status(EvaluateResponse::ERROR);
+    response.set_message(message);
+    ds::log::debug([] { return "Sending response: ERROR"; });
+}
+
+void set_result(EvaluateResponse &response, std::exception_ptr error, const DetectionResult &result)
+{
+    if (error)
+    {
+        set_error(response, inference_error(error));
+        return;
+    }
+
+    response.set_mse(result.mse);
+    ds::log::debug([&] { return "Reconstruction MSE: " + std::to_string(result.mse); });
+    if (result.status == DetectionStatus::Anomaly)
+    {
+        response.set_status(EvaluateResponse::ANOMALY);
+        response.set_message("ANOMALY");
+    }
+    else
+    {
+        response.set_status(EvaluateResponse::OK);
+        response.set_message("OK");
+    }
+    ds::log::debug([&] { return "Sending response: " + response.message(); });
+}
+} // namespace
+
+// Anything posted to a completion queue; the queue's polling thread passes each event
+// to the tag it was posted with.
+class GrpcServer::Tag
+{
+public:
+    virtual ~Tag() = default;
+    virtual void complete(bool ok) = 0;
+};
+
+// Unary call slot. It waits for an RPC on its completion queue, lets the derived call
+// answer it and then waits for the next RPC with the same messages, so serving
+// allocates no per-call state of its own.
+template <typename Request, typename Response>
+class GrpcServer::UnaryCall : public Tag
+{
+public:
+    UnaryCall(GrpcServer &server, AsyncService &service, grpc::ServerCompletionQueue &queue)
+        : server_(server),
+          service_(service),
+          queue_(queue)
+    {
+    }
+
+    // A fresh context per RPC; gRPC does not allow reusing one.
+    void await()
+    {
+        request_.Clear();
+        response_.Clear();
+        responder_.reset();
+        context_.reset();
+        context_.emplace();
+        responder_.emplace(&*context_);
+        waiting_ = true;
+        request_next(queue_);
+    }
+
+    void complete(bool ok) override
+    {
+        if (waiting_)
+        {
+            // A pending request only fails once the server shuts down.
+            if (!ok)
             {
-                raw << ' ';
+                server_.retire();
+                return;
             }
-            raw << values[i];
+            waiting_ = false;
+            evaluate();
+            return;
+        }
+
+        if (server_.stopping_.load(std::memory_order_acquire))
+        {
+            server_.retire();
+            return;
         }
+        await();
+    }
+
+protected:
+    virtual void request_next(grpc::ServerCompletionQueue &queue) = 0;
+    virtual void evaluate() = 0;
+
+    // Safe from an inference worker: nothing else touches this call until the queue
+    // reports the finish.
+    void finish()
+    {
+        responder_->Finish(response_, grpc::Status::OK, static_cast<Tag *>(this));
+    }
+
+    GrpcServer &server_;
+    AsyncService &service_;
+    std::optional<grpc::ServerContext> context_;
+    std::optional<grpc::ServerAsyncResponseWriter<Response>> responder_;
+    Request request_;
+    Response response_;
+
+private:
+    grpc::ServerCompletionQueue &queue_;
+    bool waiting_{true};
+};
+
+// Evaluate: one vector through the shared scheduler queue.
+class GrpcServer::EvaluateCall final : public UnaryCall<EvaluateRequest, EvaluateResponse>
+{
+public:
+    using UnaryCall::UnaryCall;
+
+private:
+    void request_next(grpc::ServerCompletionQueue &queue) override
+    {
+        service_.RequestEvaluate(&*context_, &request_, &*responder_, &queue, &queue, static_cast<Tag *>(this));
+    }
 
-        ds::log::info("Client request: " + context->peer());
-        ds::log::info("Received raw: " + raw.str());
+    void evaluate() override
+    {
+        response_.set_request_id(request_.request_id());
 
-        if (values.size() != expected_input_size_)
+        std::vector<float> values;
+        const std::string error = read_request(request_, *context_, server_.expected_input_size_, values);
+        if (!error.empty())
         {
-            response->set_status(datasentinel::v1::EvaluateResponse::ERROR);
-            response->set_message("Invalid input size. Expected " + std::to_string(expected_input_size_) +
-                                  ", got " + std::to_string(values.size()));
-            ds::log::error(response->message());
-            ds::log::info("Sending response: ERROR");
-            return grpc::Status::OK;
+            set_error(response_, error);
+            finish();
+            return;
         }
 
-        const auto result = detector_.evaluate(values);
-        response->set_mse(result.mse);
-        ds::log::info("Reconstruction MSE: " + std::to_string(result.mse));
+        server_.scheduler_.submit(std::move(values), [this](std::exception_ptr error, const DetectionResult &result) {
+            set_result(response_, error, result);
+            finish();
+        });
+    }
+};
+
+// EvaluateBatch: all rows of a call scored by one backend call.
+class GrpcServer::EvaluateBatchCall final : public UnaryCall<EvaluateBatchRequest, EvaluateBatchResponse>
+{
+public:
+    using UnaryCall::UnaryCall;
 
-        if (result.status == DetectionStatus::Anomaly)
+private:
+    void request_next(grpc::ServerCompletionQueue &queue) override
+    {
+        service_.RequestEvaluateBatch(&*context_, &request_, &*responder_, &queue, &queue, static_cast<Tag *>(this));
+    }
+
+    void evaluate() override
+    {
+        const std::size_t rows = request_.rows();
+        ds::log::debug([&] { return "Client request: " + context_->peer() + ", " + std::to_string(rows) + " rows"; });
+
+        std::vector<float> values;
+        std::string error = decode_request_values(request_, values);
+        if (error.empty() && (rows == 0 || rows > wire::kMaxBatchRows))
         {
-            response->set_status(datasentinel::v1::EvaluateResponse::ANOMALY);
-            response->set_message("ANOMALY");
+            error = "Invalid row count. Expected 1 to " + std::to_string(wire::kMaxBatchRows) + ", got " +
+                    std::to_string(rows);
         }
-        else
+        else if (error.empty() && values.size() != rows * server_.expected_input_size_)
         {
-            response->set_status(datasentinel::v1::EvaluateResponse::OK);
-            response->set_message("OK");
+            error = "Invalid input size. Expected " + std::to_string(rows) + " x " +
+                    std::to_string(server_.expected_input_size_) + " values, got " + std::to_string(values.size());
+        }
+        if (!error.empty())
+        {
+            set_error(response_, error);
+            finish();
+            return;
         }
 
-        ds::log::info("Sending response: " + response->message());
+        server_.scheduler_.submit_batch(
+            std::move(values), rows, [this](std::exception_ptr error, std::span<const DetectionResult> results) {
+                if (error)
+                {
+                    set_error(response_, inference_error(error));
+                    finish();
+                    return;
+                }
+
+                std::size_t anomalies = 0;
+                response_.mutable_statuses()->Reserve(static_cast<int>(results.size()));
+                response_.mutable_mse()->Reserve(static_cast<int>(results.size()));
+                for (const DetectionResult &result : results)
+                {
+                    const bool anomaly = result.status == DetectionStatus::Anomaly;
+                    anomalies += anomaly ? 1 : 0;
+                    response_.add_statuses(anomaly ? EvaluateResponse::ANOMALY : EvaluateResponse::OK);
+                    response_.add_mse(result.mse);
+                }
+                response_.set_status(EvaluateResponse::OK);
+                response_.set_message("OK");
+                ds::log::debug([&] {
+                    return "Sending response: " + std::to_string(results.size()) + " rows, " +
+                           std::to_string(anomalies) + " anomalies";
+                });
+                finish();
+            });
+    }
+};
 
-        return grpc::Status::OK;
+// EvaluateStream slot. While a stream is open it keeps one read outstanding, submits
+// every request to the scheduler as it arrives and writes replies as they complete, so
+// the requests of one stream are batched with each other and with everything else
+// queued. Replies that complete while a write is in flight go out together in one
+// flush. Like TCP connections, a stream stops reading while it has too many requests
+// in flight. Once the stream ends the slot waits for the next one.
+class GrpcServer::StreamCall final : public Tag
+{
+public:
+    StreamCall(GrpcServer &server, AsyncService &service, grpc::ServerCompletionQueue &queue, std::size_t &idle_slots)
+        : server_(server),
+          service_(service),
+          queue_(queue),
+          idle_slots_(idle_slots)
+    {
+    }
+
+    void await()
+    {
+        stream_.reset();
+        context_.reset();
+        context_.emplace();
+        stream_.emplace(&*context_);
+        state_ = State::Waiting;
+        reading_ = false;
+        input_done_ = false;
+        output_failed_ = false;
+        ++idle_slots_;
+        service_.RequestEvaluateStream(&*context_, &*stream_, &queue_, &queue_, static_cast<Tag *>(this));
+    }
+
+    // New streams and finished ones; both arrive on this slot's polling thread.
+    void complete(bool ok) override
+    {
+        if (state_ == State::Waiting)
+        {
+            --idle_slots_;
+            if (!ok)
+            {
+                server_.retire();
+                return;
+            }
+
+            // Keep a slot waiting so the next stream is not held up behind this one.
+            if (idle_slots_ == 0 && !server_.stopping_.load(std::memory_order_acquire))
+            {
+                server_.add_stream_slot(queue_, idle_slots_);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            state_ = State::Streaming;
+            read();
+            return;
+        }
+
+        if (server_.stopping_.load(std::memory_order_acquire))
+        {
+            server_.retire();
+            return;
+        }
+        await();
     }
 
 private:
-    AnomalyDetector &detector_;
-    std::size_t expected_input_size_;
+    enum class State
+    {
+        Waiting,
+        Streaming,
+        Finishing
+    };
+
+    // Routes the read and write events of an open stream, which may be pending at once.
+    class Operation final : public Tag
+    {
+    public:
+        Operation(StreamCall &call, void (StreamCall::*handler)(bool))
+            : call_(call),
+              handler_(handler)
+        {
+        }
+
+        void complete(bool ok) override
+        {
+            (call_.*handler_)(ok);
+        }
+
+    private:
+        StreamCall &call_;
+        void (StreamCall::*handler_)(bool);
+    };
+
+    void on_read(bool ok)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reading_ = false;
+        if (!ok)
+        {
+            // The client half-closed or went away; answer what is in flight and finish.
+            input_done_ = true;
+            finish_if_done();
+            return;
+        }
+
+        std::vector<float> values;
+        const std::string error = read_request(request_, *context_, server_.expected_input_size_, values);
+        if (!error.empty())
+        {
+            EvaluateResponse &reply = queue_reply(request_.request_id());
+            set_error(reply, error);
+            write();
+        }
+        else
+        {
+            ++in_flight_;
+            server_.scheduler_.submit(std::move(values),
+                                      [this, request_id = request_.request_id()](std::exception_ptr error,
+                                                                                 const DetectionResult &result) {
+                                          on_scored(request_id, error, result);
+                                      });
+        }
+
+        if (server_.scheduler_.admits(in_flight_))
+        {
+            read();
+        }
+    }
+
+    // Runs on an inference worker.
+    void on_scored(std::uint64_t request_id, std::exception_ptr error, const DetectionResult &result)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --in_flight_;
+        if (!output_failed_)
+        {
+            set_result(queue_reply(request_id), error, result);
+            write();
+        }
+
+        if (!reading_ && !input_done_ && server_.scheduler_.admits(in_flight_))
+        {
+            read();
+        }
+        finish_if_done();
+    }
+
+    void on_written(bool ok)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        writing_ = false;
+        if (!ok)
+        {
+            // The stream is broken; its pending read fails too, and later replies are dropped.
+            output_failed_ = true;
+            sending_.clear();
+            ready_.clear();
+            next_send_ = 0;
+        }
+        else if (++next_send_ == sending_.size())
+        {
+            sending_.clear();
+            next_send_ = 0;
+        }
+
+        write();
+        finish_if_done();
+    }
+
+    EvaluateResponse &queue_reply(std::uint64_t request_id)
+    {
+        EvaluateResponse &reply = ready_.emplace_back();
+        reply.set_request_id(request_id);
+        return reply;
+    }
+
+    // The helpers below run with mutex_ held.
+    void read()
+    {
+        reading_ = true;
+        stream_->Read(&request_, static_cast<Tag *>(&read_done_));
+    }
+
+    // Only one write may be in flight. Replies that queued up meanwhile are sent as one
+    // batch: all but the last are buffered and the last one flushes them.
+    void write()
+    {
+        if (writing_ || output_failed_)
+        {
+            return;
+        }
+        if (sending_.empty())
+        {
+            if (ready_.empty())
+            {
+                return;
+            }
+            sending_.swap(ready_);
+        }
+
+        grpc::WriteOptions options;
+        if (next_send_ + 1 < sending_.size())
+        {
+            options.set_buffer_hint();
+        }
+        writing_ = true;
+        stream_->Write(sending_[next_send_], options, static_cast<Tag *>(&write_done_));
+    }
+
+    void finish_if_done()
+    {
+        if (state_ != State::Streaming || !input_done_ || in_flight_ > 0 || writing_ || !ready_.empty() ||
+            !sending_.empty())
+        {
+            return;
+        }
+
+        state_ = State::Finishing;
+        stream_->Finish(grpc::Status::OK, static_cast<Tag *>(this));
+    }
+
+    GrpcServer &server_;
+    AsyncService &service_;
+    grpc::ServerCompletionQueue &queue_;
+    // Slots of this queue waiting for a stream; only its polling thread touches it.
+    std::size_t &idle_slots_;
+    Operation read_done_{*this, &StreamCall::on_read};
+    Operation write_done_{*this, &StreamCall::on_written};
+    std::optional<grpc::ServerContext> context_;
+    std::optional<grpc::ServerAsyncReaderWriter<EvaluateResponse, EvaluateRequest>> stream_;
+    EvaluateRequest request_;
+
+    std::mutex mutex_;
+    State state_{State::Waiting};
+    bool reading_{false};
+    bool input_done_{false};
+    bool writing_{false};
+    bool output_failed_{false};
+    std::size_t in_flight_{0};
+    std::vector<EvaluateResponse> ready_;
+    std::vector<EvaluateResponse> sending_;
+    std::size_t next_send_{0};
 };
-} // namespace
 
 GrpcServer::GrpcServer(std::uint16_t port,
-                       AnomalyDetector &detector,
-                       std::size_t expected_input_size)
+                       InferenceScheduler &scheduler,
+                       std::size_t expected_input_size,
+                       std::size_t completion_queues,
+                       std::size_t calls_per_queue)
     : port_(port),
-      detector_(detector),
-      expected_input_size_(expected_input_size)
+      scheduler_(scheduler),
+      expected_input_size_(expected_input_size),
+      completion_queues_(resolve_thread_count(completion_queues)),
+      calls_per_queue_(std::max<std::size_t>(calls_per_queue, 1))
 {
 }
 
-void GrpcServer::run()
+GrpcServer::~GrpcServer()
 {
-    InferenceServiceImpl service(detector_, expected_input_size_);
+    if (server_ != nullptr)
+    {
+        shutdown(std::chrono::seconds(0));
+    }
+}
+
+void GrpcServer::start()
+{
+    service_ = std::make_unique<AsyncService>();
     grpc::ServerBuilder builder;
 
     const std::string address = "0.0.0.0:" + std::to_string(port_);
     builder.AddListeningPort(address, grpc::InsecureServerCredentials());
-    builder.RegisterService(&service);
+    builder.RegisterService(service_.get());
+    for (std::size_t i = 0; i < completion_queues_; ++i)
+    {
+        queues_.push_back(builder.AddCompletionQueue());
+    }
 
-    std::unique_ptr<grpc::Server> server(builder.BuildAndStart());
-    if (server == nullptr)
+    server_ = builder.BuildAndStart();
+    if (server_ == nullptr)
     {
         throw std::runtime_error("Failed to start gRPC server on " + address);
     }
 
-    ds::log::info("gRPC server listening on " + address);
-    server->Wait();
+    // Streams are long-lived, so stream slots start with one per queue and grow with
+    // the number of open streams instead of being capped like unary slots.
+    auto &service = static_cast<AsyncService &>(*service_);
+    idle_stream_slots_.assign(queues_.size(), 0);
+    for (std::size_t q = 0; q < queues_.size(); ++q)
+    {
+        for (std::size_t i = 0; i < calls_per_queue_; ++i)
+        {
+            auto call = std::make_unique<EvaluateCall>(*this, service, *queues_[q]);
+            call->await();
+            adopt(std::move(call));
+        }
+        for (std::size_t i = 0; i < kBatchCallsPerQueue; ++i)
+        {
+            auto call = std::make_unique<EvaluateBatchCall>(*this, service, *queues_[q]);
+            call->await();
+            adopt(std::move(call));
+        }
+        add_stream_slot(*queues_[q], idle_stream_slots_[q]);
+    }
+
+    pollers_.reserve(queues_.size());
+    for (auto &queue : queues_)
+    {
+        pollers_.emplace_back([this, &queue] { poll(*queue); });
+    }
+
+    ds::log::info("gRPC server listening on " + address + " with " + std::to_string(completion_queues_) +
+                  " completion queues");
+}
+
+void GrpcServer::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    state_changed_.wait(lock, [this] { return stopped_; });
+}
+
+void GrpcServer::shutdown(std::chrono::seconds deadline)
+{
+    if (stopping_.exchange(true, std::memory_order_acq_rel))
+    {
+        wait();
+        return;
+    }
+
+    server_->Shutdown(std::chrono::system_clock::now() + deadline);
+
+    // Pending requests fail once the server is down and running calls finish or are
+    // cancelled; only after every slot has retired is nothing left to post to the queues.
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        state_changed_.wait(lock, [this] { return retired_calls_ == calls_.size(); });
+    }
+
+    for (auto &queue : queues_)
+    {
+        queue->Shutdown();
+    }
+    for (auto &poller : pollers_)
+    {
+        poller.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+    state_changed_.notify_all();
+}
+
+void GrpcServer::run()
+{
+    start();
+    wait();
+}
+
+void GrpcServer::poll(grpc::ServerCompletionQueue &queue)
+{
+    void *tag = nullptr;
+    bool ok = false;
+    while (queue.Next(&tag, &ok))
+    {
+        static_cast<Tag *>(tag)->complete(ok);
+    }
+}
+
+void GrpcServer::add_stream_slot(grpc::ServerCompletionQueue &queue, std::size_t &idle_slots)
+{
+    auto call = std::make_unique<StreamCall>(*this, static_cast<AsyncService &>(*service_), queue, idle_slots);
+    StreamCall &slot = *call;
+    adopt(std::move(call));
+    slot.await();
+}
+
+void GrpcServer::adopt(std::unique_ptr<Tag> call)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    calls_.push_back(std::move(call));
+}
+
+void GrpcServer::retire()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (++retired_calls_ == calls_.size())
+    {
+        state_changed_.notify_all();
+    }
 }
 } // namespace ds
@@ -0,0 +1,24 @@
+#include "IInferenceBackend.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ds
+{
+void IInferenceBackend::reconstruct_batch(std::span<const float> input, std::span<float> output)
+{
+    const std::size_t row_size = expected_input_size();
+    if (row_size == 0 || input.size() % row_size != 0 || output.size() != input.size())
+    {
+        throw std::runtime_error("Invalid batch shape for " + backend_name() + " backend");
+    }
+
+    std::vector<float> row(row_size);
+    for (std::size_t offset = 0; offset < input.size(); offset += row_size)
+    {
+        std::copy_n(input.begin() + static_cast<std::ptrdiff_t>(offset), row_size, row.begin());
+        const auto reconstructed = reconstruct(row);
+        std::copy_n(reconstructed.begin(), row_size, output.begin() + static_cast<std::ptrdiff_t>(offset));
+    }
+}
+} // namespace ds
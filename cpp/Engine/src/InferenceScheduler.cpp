@@ -0,0 +1,202 @@
+#include "InferenceScheduler.hpp"
+
+#include <boost/asio/post.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "RequestMetrics.hpp"
+#include "ThreadCount.hpp"
+
+namespace ds
+{
+InferenceScheduler::InferenceScheduler(AnomalyDetector &detector,
+                                       std::size_t worker_threads,
+                                       InFlightLimits limits,
+                                       std::size_t max_batch_rows)
+    : detector_(detector),
+      worker_threads_(resolve_thread_count(worker_threads)),
+      limits_(limits),
+      max_batch_rows_(std::max<std::size_t>(max_batch_rows, 1)),
+      pool_(std::in_place, worker_threads_),
+      executor_(pool_->get_executor())
+{
+}
+
+InferenceScheduler::InferenceScheduler(AnomalyDetector &detector,
+                                       boost::asio::any_io_executor executor,
+                                       InFlightLimits limits,
+                                       std::size_t max_batch_rows)
+    : detector_(detector),
+      worker_threads_(1),
+      limits_(limits),
+      max_batch_rows_(std::max<std::size_t>(max_batch_rows, 1)),
+      executor_(std::move(executor))
+{
+}
+
+InferenceScheduler::~InferenceScheduler()
+{
+    if (pool_)
+    {
+        pool_->join();
+    }
+}
+
+void InferenceScheduler::submit(std::vector<float> input, Completion on_complete)
+{
+    count_submitted();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(Request{std::move(input), std::move(on_complete)});
+        if (draining_ == worker_threads_)
+        {
+            // Every worker is busy and will pick this request up when it comes back.
+            return;
+        }
+        ++draining_;
+    }
+
+    boost::asio::post(executor_, [this] { drain(); });
+}
+
+void InferenceScheduler::submit_batch(std::vector<float> inputs, std::size_t rows, BatchCompletion on_complete)
+{
+    count_submitted();
+
+    boost::asio::post(executor_, [this, inputs = std::move(inputs), rows, on_complete = std::move(on_complete)] {
+        thread_local std::vector<DetectionResult> results;
+        results.resize(rows);
+        std::exception_ptr error;
+        try
+        {
+            detector_.evaluate_batch(inputs, results);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        in_flight_.remove();
+        on_complete(error, results);
+    });
+}
+
+void InferenceScheduler::count_submitted()
+{
+    in_flight_.add();
+}
+
+void InferenceScheduler::drain()
+{
+    thread_local std::vector<Request> batch;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.empty())
+            {
+                --draining_;
+                return;
+            }
+
+            const std::size_t rows = std::min(queue_.size(), max_batch_rows_);
+            std::move(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(rows), std::back_inserter(batch));
+            queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(rows));
+        }
+
+        score(batch);
+        batch.clear();
+    }
+}
+
+void InferenceScheduler::score(std::vector<Request> &batch)
+{
+    // Rows of another width than the first cannot share its backend call and are
+    // scored on their own.
+    const std::size_t row_size = batch.front().input.size();
+    thread_local std::vector<float> inputs;
+    thread_local std::vector<DetectionResult> results;
+    thread_local std::vector<Request *> rows;
+    inputs.clear();
+    rows.clear();
+
+    for (Request &request : batch)
+    {
+        if (batch.size() > 1 && request.input.size() == row_size)
+        {
+            inputs.insert(inputs.end(), request.input.begin(), request.input.end());
+            rows.push_back(&request);
+            continue;
+        }
+
+        DetectionResult result{.mse = 0.0, .status = DetectionStatus::Ok};
+        std::exception_ptr error;
+        try
+        {
+            result = detector_.evaluate(request.input);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        finish(request, error, result);
+    }
+
+    if (rows.empty())
+    {
+        return;
+    }
+
+    results.resize(rows.size());
+    std::exception_ptr error;
+    try
+    {
+        detector_.evaluate_batch(inputs, results);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    const DetectionResult failed{.mse = 0.0, .status = DetectionStatus::Ok};
+    for (std::size_t row = 0; row < rows.size(); ++row)
+    {
+        finish(*rows[row], error, error ? failed : results[row]);
+    }
+}
+
+void InferenceScheduler::finish(Request &request, std::exception_ptr error, const DetectionResult &result)
+{
+    // Release the slot first so the session woken by this completion sees it free.
+    in_flight_.remove();
+    request.on_complete(error, result);
+}
+
+bool InferenceScheduler::admits(std::size_t connection_in_flight) const
+{
+    if (connection_in_flight == 0)
+    {
+        return true;
+    }
+
+    if (limits_.per_connection > 0 && connection_in_flight >= limits_.per_connection)
+    {
+        return false;
+    }
+
+    return limits_.total == 0 || in_flight_.depth() < limits_.total;
+}
+
+std::size_t InferenceScheduler::in_flight() const
+{
+    return in_flight_.depth();
+}
+
+std::size_t InferenceScheduler::worker_threads() const
+{
+    return worker_threads_;
+}
+} // namespace ds
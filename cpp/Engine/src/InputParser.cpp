@@ -1,20 +1,202 @@
 #include "InputParser.hpp"
 
-#include <sstream>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
 
 namespace ds
 {
-std::vector<float> parse_input_line(const std::string &input)
+namespace
 {
-    std::vector<float> values;
-    std::stringstream stream(input);
-    float value = 0.0F;
+bool is_separator(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Any integer with at most 7 decimal digits and these powers of ten are exact in
+// float, so one float division yields the correctly rounded result.
+constexpr std::size_t kMaxFixedPointDigits = 7;
+constexpr std::array<float, kMaxFixedPointDigits + 1> kPow10{
+    1e0F, 1e1F, 1e2F, 1e3F, 1e4F, 1e5F, 1e6F, 1e7F,
+};
+
+// Fast path for short fixed-precision decimals such as the producer's "%.3f" output.
+// Returns nullptr whenever the token needs the general parser (exponents, long
+// mantissas, missing integer digits, ...).
+const char *parse_fixed_point(const char *cursor, const char *end, float &value)
+{
+    const bool negative = (*cursor == '-');
+    if (negative)
+    {
+        ++cursor;
+    }
+
+    std::uint32_t mantissa = 0;
+    std::size_t digits = 0;
+    while (cursor != end && static_cast<unsigned char>(*cursor - '0') < 10)
+    {
+        mantissa = mantissa * 10 + static_cast<std::uint32_t>(*cursor - '0');
+        ++digits;
+        ++cursor;
+    }
+
+    if (digits == 0)
+    {
+        return nullptr;
+    }
+
+    std::size_t fraction_digits = 0;
+    if (cursor != end && *cursor == '.')
+    {
+        ++cursor;
+        while (cursor != end && static_cast<unsigned char>(*cursor - '0') < 10)
+        {
+            mantissa = mantissa * 10 + static_cast<std::uint32_t>(*cursor - '0');
+            ++fraction_digits;
+            ++cursor;
+        }
+        digits += fraction_digits;
+    }
+
+    if (digits > kMaxFixedPointDigits || (cursor != end && !is_separator(*cursor)))
+    {
+        return nullptr;
+    }
+
+    const float magnitude = static_cast<float>(mantissa) / kPow10[fraction_digits];
+    value = negative ? -magnitude : magnitude;
+    return cursor;
+}
+
+// Parses one number starting at `cursor`; returns the end of the token, or nullptr
+// when the token is not a finite number followed by a separator or the end of input.
+const char *parse_number(const char *cursor, const char *end, float &value)
+{
+    // from_chars rejects an explicit plus sign, which stream extraction used to accept.
+    if (*cursor == '+' && cursor + 1 != end && *(cursor + 1) != '-')
+    {
+        ++cursor;
+    }
+
+    if (const char *token_end = parse_fixed_point(cursor, end, value))
+    {
+        return token_end;
+    }
+
+    const auto [token_end, ec] = std::from_chars(cursor, end, value);
+    if (ec != std::errc{} || (token_end != end && !is_separator(*token_end)) || !std::isfinite(value))
+    {
+        return nullptr;
+    }
+
+    return token_end;
+}
+} // namespace
+
+ParseResult parse_input_values(std::string_view input, std::span<float> output)
+{
+    const char *cursor = input.data();
+    const char *const end = input.data() + input.size();
+    std::size_t count = 0;
+
+    while (true)
+    {
+        while (cursor != end && is_separator(*cursor))
+        {
+            ++cursor;
+        }
+
+        if (cursor == end)
+        {
+            return ParseResult{ParseStatus::Ok, count};
+        }
+
+        if (count == output.size())
+        {
+            return ParseResult{ParseStatus::TooManyValues, count};
+        }
+
+        float value = 0.0F;
+        cursor = parse_number(cursor, end, value);
+        if (cursor == nullptr)
+        {
+            return ParseResult{ParseStatus::Malformed, count};
+        }
+
+        output[count++] = value;
+    }
+}
+
+bool parse_input_value(std::string_view token, float &value)
+{
+    if (token.empty())
+    {
+        return false;
+    }
+
+    const char *const end = token.data() + token.size();
+    return parse_number(token.data(), end, value) == end;
+}
+
+ParseResult parse_request_line(std::string_view text,
+                               std::span<const TextToken> tokens,
+                               std::span<float> output,
+                               std::optional<std::uint64_t> &request_id)
+{
+    request_id.reset();
+
+    if (!tokens.empty() && text[tokens.front().offset] == kRequestIdPrefix)
+    {
+        const char *begin = text.data() + tokens.front().offset + 1;
+        const char *end = text.data() + tokens.front().offset + tokens.front().length;
+        std::uint64_t id = 0;
+        const auto [id_end, ec] = std::from_chars(begin, end, id);
+        if (begin == end || ec != std::errc{} || id_end != end)
+        {
+            return ParseResult{ParseStatus::Malformed, 0};
+        }
+
+        request_id = id;
+        tokens = tokens.subspan(1);
+    }
+
+    if (tokens.size() > output.size())
+    {
+        return ParseResult{ParseStatus::TooManyValues, 0};
+    }
+
+    for (std::size_t i = 0; i < tokens.size(); ++i)
+    {
+        if (!parse_input_value(text.substr(tokens[i].offset, tokens[i].length), output[i]))
+        {
+            return ParseResult{ParseStatus::Malformed, i};
+        }
+    }
+
+    return ParseResult{ParseStatus::Ok, tokens.size()};
+}
+
+bool parse_batch_header(std::string_view text, std::span<const TextToken> tokens, std::size_t &rows)
+{
+    rows = 0;
+    if (tokens.empty() || text.substr(tokens.front().offset, tokens.front().length) != kBatchKeyword)
+    {
+        return false;
+    }
 
-    while (stream >> value)
+    if (tokens.size() == 2)
     {
-        values.push_back(value);
+        const char *begin = text.data() + tokens[1].offset;
+        const char *end = begin + tokens[1].length;
+        std::size_t count = 0;
+        const auto [count_end, ec] = std::from_chars(begin, end, count);
+        if (ec == std::errc{} && count_end == end)
+        {
+            rows = count;
+        }
     }
 
-    return values;
+    return true;
 }
 } // namespace ds
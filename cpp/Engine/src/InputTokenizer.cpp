@@ -0,0 +1,255 @@
+#include "InputTokenizer.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DS_TOKENIZER_X86 1
+#else
+#define DS_TOKENIZER_X86 0
+#endif
+
+namespace ds
+{
+namespace
+{
+// Every backend classifies 64-byte blocks into two bit masks: bytes that separate
+// tokens (whitespace, including the newline) and newlines alone.
+constexpr std::size_t kBlockSize = 64;
+
+struct BlockMasks
+{
+    std::uint64_t separators;
+    std::uint64_t newlines;
+};
+
+using ClassifyBlockFn = BlockMasks (*)(const char *block);
+
+bool is_separator(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f' || c == '\n';
+}
+
+BlockMasks classify_scalar(const char *block, std::size_t length)
+{
+    BlockMasks masks{0, 0};
+    for (std::size_t i = 0; i < length; ++i)
+    {
+        masks.separators |= static_cast<std::uint64_t>(is_separator(block[i])) << i;
+        masks.newlines |= static_cast<std::uint64_t>(block[i] == '\n') << i;
+    }
+    return masks;
+}
+
+BlockMasks classify_block_scalar(const char *block)
+{
+    return classify_scalar(block, kBlockSize);
+}
+
+#if DS_TOKENIZER_X86
+__attribute__((target("sse4.2"))) BlockMasks classify_block_sse42(const char *block)
+{
+    const __m128i separator_set = _mm_setr_epi8(' ', '\t', '\r', '\v', '\f', '\n', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i newline = _mm_set1_epi8('\n');
+    constexpr int kMode = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK;
+
+    BlockMasks masks{0, 0};
+    for (std::size_t lane = 0; lane < kBlockSize / 16; ++lane)
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + lane * 16));
+        const auto separators =
+            static_cast<std::uint16_t>(_mm_cvtsi128_si32(_mm_cmpestrm(separator_set, 6, bytes, 16, kMode)));
+        const auto newlines = static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)));
+
+        masks.separators |= static_cast<std::uint64_t>(separators) << (lane * 16);
+        masks.newlines |= static_cast<std::uint64_t>(newlines) << (lane * 16);
+    }
+    return masks;
+}
+
+__attribute__((target("avx2"))) BlockMasks classify_block_avx2(const char *block)
+{
+    BlockMasks masks{0, 0};
+    for (std::size_t lane = 0; lane < kBlockSize / 32; ++lane)
+    {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + lane * 32));
+        const __m256i newlines = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'));
+        __m256i separators = _mm256_or_si256(newlines, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')));
+        separators = _mm256_or_si256(separators, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t')));
+        separators = _mm256_or_si256(separators, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\r')));
+        separators = _mm256_or_si256(separators, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\v')));
+        separators = _mm256_or_si256(separators, _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\f')));
+
+        masks.separators |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(separators)))
+                            << (lane * 32);
+        masks.newlines |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(newlines)))
+                          << (lane * 32);
+    }
+    return masks;
+}
+#endif
+
+struct Dispatch
+{
+    ClassifyBlockFn classify;
+    const char *isa_name;
+};
+
+Dispatch select_dispatch()
+{
+#if DS_TOKENIZER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return Dispatch{classify_block_avx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+        return Dispatch{classify_block_sse42, "sse4.2"};
+    }
+#endif
+    return Dispatch{classify_block_scalar, "scalar"};
+}
+
+const Dispatch &dispatch()
+{
+    static const Dispatch selected = select_dispatch();
+    return selected;
+}
+
+bool find_dispatch(std::string_view isa_name, Dispatch &found)
+{
+    if (isa_name == "scalar")
+    {
+        found = Dispatch{classify_block_scalar, "scalar"};
+        return true;
+    }
+#if DS_TOKENIZER_X86
+    __builtin_cpu_init();
+    if (isa_name == "avx2" && __builtin_cpu_supports("avx2"))
+    {
+        found = Dispatch{classify_block_avx2, "avx2"};
+        return true;
+    }
+    if (isa_name == "sse4.2" && __builtin_cpu_supports("sse4.2"))
+    {
+        found = Dispatch{classify_block_sse42, "sse4.2"};
+        return true;
+    }
+#endif
+    return false;
+}
+
+class TokenScanner
+{
+public:
+    explicit TokenScanner(TokenizedText &out)
+        : out_(out)
+    {
+    }
+
+    // Turns one block's masks into token and line spans. Bits at and above
+    // `length` are ignored.
+    void scan(std::uint32_t base, std::size_t length, BlockMasks masks)
+    {
+        const std::uint64_t valid = (length == kBlockSize) ? ~std::uint64_t{0} : ((std::uint64_t{1} << length) - 1);
+        // Bit i is set when byte i - 1 was a separator (or nothing precedes it).
+        const std::uint64_t previous_separators = (masks.separators << 1) | (in_token_ ? 0 : 1);
+
+        const std::uint64_t starts = ~masks.separators & previous_separators & valid;
+        const std::uint64_t ends = masks.separators & ~previous_separators & valid;
+        const std::uint64_t newlines = masks.newlines & valid;
+
+        std::uint64_t events = starts | ends | newlines;
+        while (events != 0)
+        {
+            const auto bit_index = static_cast<std::uint32_t>(__builtin_ctzll(events));
+            const std::uint64_t bit = std::uint64_t{1} << bit_index;
+            const std::uint32_t position = base + bit_index;
+            events &= events - 1;
+
+            if ((starts & bit) != 0)
+            {
+                token_start_ = position;
+            }
+            else if ((ends & bit) != 0)
+            {
+                out_.tokens.push_back(TextToken{token_start_, position - token_start_});
+            }
+
+            if ((newlines & bit) != 0)
+            {
+                const auto token_count = static_cast<std::uint32_t>(out_.tokens.size()) - line_first_token_;
+                out_.lines.push_back(TextLine{line_start_, position - line_start_, line_first_token_, token_count});
+                line_start_ = position + 1;
+                line_first_token_ = static_cast<std::uint32_t>(out_.tokens.size());
+            }
+        }
+
+        in_token_ = (masks.separators & (std::uint64_t{1} << (length - 1))) == 0;
+    }
+
+    void finish()
+    {
+        // Drop tokens of the trailing partial line; they are rescanned once its newline arrives.
+        out_.tokens.resize(line_first_token_);
+        out_.consumed = line_start_;
+    }
+
+private:
+    TokenizedText &out_;
+    bool in_token_{false};
+    std::uint32_t token_start_{0};
+    std::uint32_t line_start_{0};
+    std::uint32_t line_first_token_{0};
+};
+
+void tokenize_with(ClassifyBlockFn classify, std::string_view text, TokenizedText &out)
+{
+    out.clear();
+
+    TokenScanner scanner(out);
+
+    std::size_t position = 0;
+    for (; position + kBlockSize <= text.size(); position += kBlockSize)
+    {
+        scanner.scan(static_cast<std::uint32_t>(position), kBlockSize, classify(text.data() + position));
+    }
+
+    const std::size_t tail = text.size() - position;
+    if (tail > 0)
+    {
+        scanner.scan(static_cast<std::uint32_t>(position), tail, classify_scalar(text.data() + position, tail));
+    }
+
+    scanner.finish();
+}
+} // namespace
+
+void TokenizedText::clear()
+{
+    tokens.clear();
+    lines.clear();
+    consumed = 0;
+}
+
+void tokenize_lines(std::string_view text, TokenizedText &out)
+{
+    tokenize_with(dispatch().classify, text, out);
+}
+
+bool tokenize_lines_with(std::string_view isa_name, std::string_view text, TokenizedText &out)
+{
+    Dispatch selected{};
+    if (!find_dispatch(isa_name, selected))
+    {
+        return false;
+    }
+
+    tokenize_with(selected.classify, text, out);
+    return true;
+}
+
+const char *tokenizer_isa_name()
+{
+    return dispatch().isa_name;
+}
+} // namespace ds
@@ -0,0 +1,271 @@
+#include "IoUring.hpp"
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace ds::uring
+{
+namespace
+{
+int io_uring_setup(unsigned entries, io_uring_params &params)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+template <typename T> T *at_offset(void *base, std::uint32_t offset)
+{
+    return reinterpret_cast<T *>(static_cast<char *>(base) + offset);
+}
+
+// In C++ the kernel header's flexible array member sits behind a one-byte empty
+// struct, so the buffer entries are addressed directly from the ring base.
+io_uring_buf *buffer_entries(io_uring_buf_ring *ring)
+{
+    return reinterpret_cast<io_uring_buf *>(ring);
+}
+
+std::string errno_message(const std::string &what)
+{
+    return what + ": " + std::strerror(errno);
+}
+} // namespace
+
+Ring::Ring(unsigned entries)
+{
+    io_uring_params params{};
+    // Only the owning thread submits, so the kernel may defer completion work
+    // until that thread asks for events. Older kernels reject the flags.
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    fd_ = io_uring_setup(entries, params);
+    if (fd_ < 0 && errno == EINVAL)
+    {
+        params = io_uring_params{};
+        fd_ = io_uring_setup(entries, params);
+    }
+
+    if (fd_ < 0)
+    {
+        throw std::runtime_error(errno_message("io_uring_setup failed"));
+    }
+
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0)
+    {
+        ::close(fd_);
+        throw std::runtime_error("io_uring without IORING_FEAT_SINGLE_MMAP is not supported");
+    }
+
+    // With a single mapping the completion queue lives in the submission queue region.
+    sq_mapping_size_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    sq_mapping_ = ::mmap(nullptr, sq_mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                         IORING_OFF_SQ_RING);
+    if (sq_mapping_ == MAP_FAILED)
+    {
+        const std::string message = errno_message("Failed to map io_uring queues");
+        ::close(fd_);
+        throw std::runtime_error(message);
+    }
+    cq_mapping_ = sq_mapping_;
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                        IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        const std::string message = errno_message("Failed to map io_uring submission entries");
+        ::munmap(sq_mapping_, sq_mapping_size_);
+        ::close(fd_);
+        throw std::runtime_error(message);
+    }
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    sq_head_ = at_offset<unsigned>(sq_mapping_, params.sq_off.head);
+    sq_tail_ = at_offset<unsigned>(sq_mapping_, params.sq_off.tail);
+    sq_mask_ = *at_offset<unsigned>(sq_mapping_, params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sq_array_ = at_offset<unsigned>(sq_mapping_, params.sq_off.array);
+    sq_local_tail_ = *sq_tail_;
+
+    cq_head_ = at_offset<unsigned>(cq_mapping_, params.cq_off.head);
+    cq_tail_ = at_offset<unsigned>(cq_mapping_, params.cq_off.tail);
+    cq_mask_ = *at_offset<unsigned>(cq_mapping_, params.cq_off.ring_mask);
+    cqes_ = at_offset<io_uring_cqe>(cq_mapping_, params.cq_off.cqes);
+
+    // Submission slots map one to one onto entries, so the index array is fixed.
+    for (unsigned i = 0; i < sq_entries_; ++i)
+    {
+        sq_array_[i] = i;
+    }
+}
+
+Ring::~Ring()
+{
+    ::munmap(sqes_, sqes_size_);
+    ::munmap(sq_mapping_, sq_mapping_size_);
+    ::close(fd_);
+}
+
+io_uring_sqe &Ring::next_sqe()
+{
+    if (sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+    {
+        submit_and_wait(0);
+    }
+
+    io_uring_sqe &sqe = sqes_[sq_local_tail_ & sq_mask_];
+    std::memset(&sqe, 0, sizeof(sqe));
+    ++sq_local_tail_;
+    return sqe;
+}
+
+void Ring::submit_and_wait(unsigned wait_for)
+{
+    const unsigned to_submit = pending_submissions();
+    __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+
+    while (io_uring_enter(fd_, to_submit, wait_for, IORING_ENTER_GETEVENTS) < 0)
+    {
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            throw std::runtime_error(errno_message("io_uring_enter failed"));
+        }
+    }
+}
+
+int Ring::fd() const
+{
+    return fd_;
+}
+
+unsigned Ring::pending_submissions() const
+{
+    return sq_local_tail_ - *sq_tail_;
+}
+
+BufferRing::BufferRing(Ring &ring, std::uint16_t group_id, std::uint16_t buffer_count, std::size_t buffer_size)
+    : ring_(ring),
+      group_id_(group_id),
+      buffer_count_(buffer_count),
+      buffer_size_(buffer_size),
+      storage_(static_cast<std::size_t>(buffer_count) * buffer_size)
+{
+    if (buffer_count_ == 0 || (buffer_count_ & (buffer_count_ - 1)) != 0)
+    {
+        throw std::runtime_error("io_uring buffer ring size must be a power of two");
+    }
+
+    entries_size_ = buffer_count_ * sizeof(io_uring_buf);
+    void *entries = ::mmap(nullptr, entries_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (entries == MAP_FAILED)
+    {
+        throw std::runtime_error(errno_message("Failed to allocate io_uring buffer ring"));
+    }
+    entries_ = static_cast<io_uring_buf_ring *>(entries);
+
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<std::uint64_t>(entries_);
+    registration.ring_entries = buffer_count_;
+    registration.bgid = group_id_;
+    if (io_uring_register(ring_.fd(), IORING_REGISTER_PBUF_RING, &registration, 1) < 0)
+    {
+        const std::string message = errno_message("Failed to register io_uring buffer ring");
+        ::munmap(entries_, entries_size_);
+        throw std::runtime_error(message);
+    }
+
+    for (std::uint16_t id = 0; id < buffer_count_; ++id)
+    {
+        io_uring_buf &entry = buffer_entries(entries_)[id];
+        entry.addr = reinterpret_cast<std::uint64_t>(storage_.data() + id * buffer_size_);
+        entry.len = static_cast<std::uint32_t>(buffer_size_);
+        entry.bid = id;
+    }
+    __atomic_store_n(&entries_->tail, buffer_count_, __ATOMIC_RELEASE);
+}
+
+BufferRing::~BufferRing()
+{
+    io_uring_buf_reg registration{};
+    registration.bgid = group_id_;
+    io_uring_register(ring_.fd(), IORING_UNREGISTER_PBUF_RING, &registration, 1);
+    ::munmap(entries_, entries_size_);
+}
+
+std::uint16_t BufferRing::group_id() const
+{
+    return group_id_;
+}
+
+std::span<char> BufferRing::buffer(std::uint16_t buffer_id, std::size_t length)
+{
+    return std::span<char>(storage_.data() + buffer_id * buffer_size_, length);
+}
+
+void BufferRing::recycle(std::uint16_t buffer_id)
+{
+    const std::uint16_t tail = entries_->tail;
+    io_uring_buf &entry = buffer_entries(entries_)[tail & (buffer_count_ - 1)];
+    entry.addr = reinterpret_cast<std::uint64_t>(storage_.data() + buffer_id * buffer_size_);
+    entry.len = static_cast<std::uint32_t>(buffer_size_);
+    entry.bid = buffer_id;
+    __atomic_store_n(&entries_->tail, static_cast<std::uint16_t>(tail + 1), __ATOMIC_RELEASE);
+}
+
+bool kernel_supports_multishot()
+{
+    try
+    {
+        Ring ring(4);
+        BufferRing buffers(ring, 0, 2, 64);
+
+        int sockets[2] = {-1, -1};
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0)
+        {
+            return false;
+        }
+
+        io_uring_sqe &sqe = ring.next_sqe();
+        sqe.opcode = IORING_OP_RECV;
+        sqe.fd = sockets[0];
+        sqe.ioprio = IORING_RECV_MULTISHOT;
+        sqe.flags = IOSQE_BUFFER_SELECT;
+        sqe.buf_group = buffers.group_id();
+
+        const char probe = 'x';
+        const bool sent = ::send(sockets[1], &probe, 1, MSG_NOSIGNAL) == 1;
+        ring.submit_and_wait(sent ? 1 : 0);
+
+        bool supported = false;
+        ring.drain_completions([&supported](const io_uring_cqe &cqe) {
+            supported = cqe.res == 1 && (cqe.flags & IORING_CQE_F_MORE) != 0;
+        });
+
+        // Tearing down the ring cancels the receive that is still armed.
+        ::close(sockets[0]);
+        ::close(sockets[1]);
+        return supported;
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+}
+} // namespace ds::uring
@@ -0,0 +1,293 @@
+#include "ListenerHandoff.hpp"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+#include "Logger.hpp"
+
+namespace ds
+{
+namespace
+{
+// The offer message is one byte saying which listeners follow, in this order, as
+// SCM_RIGHTS ancillary data. The replacement answers with one byte once it serves.
+constexpr std::uint8_t kHasTcp = 0x01;
+constexpr std::uint8_t kHasLocal = 0x02;
+constexpr std::size_t kMaxListeners = 2;
+// A replacement that stops responding mid-handoff must not wedge either side.
+constexpr timeval kHandoffTimeout{5, 0};
+
+sockaddr_un control_address(const std::string &path)
+{
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("Handoff socket path is too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+void set_timeouts(int fd)
+{
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &kHandoffTimeout, sizeof(kHandoffTimeout));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &kHandoffTimeout, sizeof(kHandoffTimeout));
+}
+} // namespace
+
+ListenerOffer::ListenerOffer(std::string control_path, Listeners listeners, std::function<void()> on_released)
+    : control_path_(std::move(control_path)),
+      listeners_(listeners),
+      on_released_(std::move(on_released))
+{
+    const sockaddr_un address = control_address(control_path_);
+
+    // The path belongs to whichever engine bound it last: a replacement binds it
+    // again only after taking the listeners, so removing it here never cuts off a
+    // handoff in progress.
+    std::error_code ignored;
+    if (std::filesystem::is_socket(control_path_, ignored))
+    {
+        std::filesystem::remove(control_path_, ignored);
+    }
+
+    control_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (control_fd_ < 0)
+    {
+        throw std::runtime_error(std::string("Failed to create handoff socket: ") + std::strerror(errno));
+    }
+
+    if (::bind(control_fd_, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(control_fd_, 1) != 0)
+    {
+        const std::string reason = std::strerror(errno);
+        ::close(control_fd_);
+        throw std::runtime_error("Failed to listen on handoff socket " + control_path_ + ": " + reason);
+    }
+
+    stop_fd_ = ::eventfd(0, EFD_CLOEXEC);
+    if (stop_fd_ < 0)
+    {
+        const std::string reason = std::strerror(errno);
+        ::close(control_fd_);
+        throw std::runtime_error("Failed to create eventfd: " + reason);
+    }
+}
+
+ListenerOffer::~ListenerOffer()
+{
+    if (thread_.joinable())
+    {
+        const std::uint64_t wake = 1;
+        [[maybe_unused]] const auto written = ::write(stop_fd_, &wake, sizeof(wake));
+        thread_.join();
+    }
+
+    // The socket file is left alone: once handed off it belongs to the replacement.
+    if (control_fd_ >= 0)
+    {
+        ::close(control_fd_);
+    }
+    ::close(stop_fd_);
+}
+
+void ListenerOffer::start()
+{
+    ds::log::info("Offering listeners for handoff on " + control_path_);
+    thread_ = std::thread([this] { run(); });
+}
+
+void ListenerOffer::run()
+{
+    while (true)
+    {
+        pollfd fds[2]{{control_fd_, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+        if (::poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ds::log::error(std::string("Handoff socket poll failed: ") + std::strerror(errno));
+            return;
+        }
+
+        if (fds[1].revents != 0)
+        {
+            return;
+        }
+
+        const int connection = ::accept4(control_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connection < 0)
+        {
+            continue;
+        }
+
+        set_timeouts(connection);
+        const bool released = hand_off(connection);
+        ::close(connection);
+
+        if (released)
+        {
+            ::close(control_fd_);
+            control_fd_ = -1;
+            ds::log::info("Listeners handed off; draining connections");
+            on_released_();
+            return;
+        }
+    }
+}
+
+bool ListenerOffer::hand_off(int connection)
+{
+    int fds[kMaxListeners];
+    std::size_t count = 0;
+    std::uint8_t which = 0;
+    if (listeners_.tcp >= 0)
+    {
+        which |= kHasTcp;
+        fds[count++] = listeners_.tcp;
+    }
+    if (listeners_.local >= 0)
+    {
+        which |= kHasLocal;
+        fds[count++] = listeners_.local;
+    }
+
+    iovec payload{&which, sizeof(which)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))]{};
+
+    msghdr message{};
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+    if (count > 0)
+    {
+        message.msg_control = control;
+        message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+        cmsghdr *header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int) * count);
+        std::memcpy(CMSG_DATA(header), fds, sizeof(int) * count);
+    }
+
+    if (::sendmsg(connection, &message, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(which)))
+    {
+        ds::log::error(std::string("Failed to hand off listeners: ") + std::strerror(errno));
+        return false;
+    }
+
+    // Both engines accept from the same queues until the replacement confirms; one
+    // that fails before confirming leaves this engine serving as if nothing happened.
+    std::uint8_t confirmed = 0;
+    if (::recv(connection, &confirmed, sizeof(confirmed), 0) != static_cast<ssize_t>(sizeof(confirmed)))
+    {
+        ds::log::error("Replacement engine did not confirm the handoff; keeping the listeners");
+        return false;
+    }
+    return true;
+}
+
+ListenerTakeover::ListenerTakeover(const std::string &control_path)
+{
+    const sockaddr_un address = control_address(control_path);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        throw std::runtime_error(std::string("Failed to create handoff socket: ") + std::strerror(errno));
+    }
+
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+    {
+        const int error = errno;
+        ::close(fd);
+        // No socket file, or one left behind by an engine that is gone: start fresh.
+        if (error == ENOENT || error == ECONNREFUSED)
+        {
+            return;
+        }
+        throw std::runtime_error("Failed to connect to handoff socket " + control_path + ": " +
+                                 std::strerror(error));
+    }
+    set_timeouts(fd);
+
+    std::uint8_t which = 0;
+    iovec payload{&which, sizeof(which)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxListeners)]{};
+
+    msghdr message{};
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    const ssize_t received = ::recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+    if (received != static_cast<ssize_t>(sizeof(which)))
+    {
+        const std::string reason = received < 0 ? std::strerror(errno) : "connection closed";
+        ::close(fd);
+        throw std::runtime_error("Failed to receive listeners from " + control_path + ": " + reason);
+    }
+
+    int fds[kMaxListeners]{-1, -1};
+    std::size_t count = 0;
+    for (cmsghdr *header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header))
+    {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS)
+        {
+            count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            std::memcpy(fds, CMSG_DATA(header), sizeof(int) * count);
+        }
+    }
+
+    std::size_t next = 0;
+    if ((which & kHasTcp) != 0 && next < count)
+    {
+        listeners_.tcp = fds[next++];
+    }
+    if ((which & kHasLocal) != 0 && next < count)
+    {
+        listeners_.local = fds[next++];
+    }
+    control_fd_ = fd;
+    taken_ = true;
+
+    ds::log::info("Took over listeners from the running engine via " + control_path);
+}
+
+ListenerTakeover::~ListenerTakeover()
+{
+    if (control_fd_ >= 0)
+    {
+        ::close(control_fd_);
+    }
+}
+
+void ListenerTakeover::confirm()
+{
+    if (control_fd_ < 0)
+    {
+        return;
+    }
+
+    const std::uint8_t confirmed = 1;
+    if (::send(control_fd_, &confirmed, sizeof(confirmed), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(confirmed)))
+    {
+        ds::log::error(std::string("Failed to confirm the handoff: ") + std::strerror(errno));
+    }
+    ::close(control_fd_);
+    control_fd_ = -1;
+}
+} // namespace ds
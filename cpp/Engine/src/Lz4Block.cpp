@@ -0,0 +1,81 @@
+#include "Lz4Block.hpp"
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#if DS_ENABLE_LZ4
+#include <lz4.h>
+#endif
+
+namespace ds::lz4
+{
+#if !DS_ENABLE_LZ4
+namespace
+{
+[[noreturn]] void throw_unavailable()
+{
+    throw std::runtime_error("LZ4 compression is unavailable because DS_ENABLE_LZ4=OFF");
+}
+} // namespace
+#endif
+
+bool available()
+{
+#if DS_ENABLE_LZ4
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::size_t compress_bound(std::size_t size)
+{
+#if DS_ENABLE_LZ4
+    if (size > LZ4_MAX_INPUT_SIZE)
+    {
+        throw std::runtime_error("LZ4 block input exceeds " + std::to_string(LZ4_MAX_INPUT_SIZE) + " bytes");
+    }
+    return static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(size)));
+#else
+    (void)size;
+    throw_unavailable();
+#endif
+}
+
+std::size_t compress(std::string_view input, std::span<char> output)
+{
+#if DS_ENABLE_LZ4
+    const int written = LZ4_compress_default(input.data(), output.data(), static_cast<int>(input.size()),
+                                             static_cast<int>(output.size()));
+    if (written <= 0)
+    {
+        throw std::runtime_error("LZ4 compression failed");
+    }
+    return static_cast<std::size_t>(written);
+#else
+    (void)input;
+    (void)output;
+    throw_unavailable();
+#endif
+}
+
+bool decompress(std::string_view input, std::span<char> output)
+{
+#if DS_ENABLE_LZ4
+    constexpr std::size_t kMaxSize = static_cast<std::size_t>(std::numeric_limits<int>::max());
+    if (input.size() > kMaxSize || output.size() > kMaxSize)
+    {
+        return false;
+    }
+
+    const int written = LZ4_decompress_safe(input.data(), output.data(), static_cast<int>(input.size()),
+                                            static_cast<int>(output.size()));
+    return written >= 0 && static_cast<std::size_t>(written) == output.size();
+#else
+    (void)input;
+    (void)output;
+    throw_unavailable();
+#endif
+}
+} // namespace ds::lz4
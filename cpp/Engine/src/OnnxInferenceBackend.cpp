@@ -1,5 +1,6 @@
 #include "OnnxInferenceBackend.hpp"
 
+#include <algorithm>
 #include <filesystem>
 #include <stdexcept>
 
@@ -11,7 +12,8 @@ OnnxInferenceBackend::OnnxInferenceBackend(const std::string &model_path)
     : env_(ORT_LOGGING_LEVEL_WARNING, "DataSentinel"),
       session_(nullptr),
       memory_info_(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)),
-      expected_input_size_(0)
+      expected_input_size_(0),
+      dynamic_batch_(false)
 {
     const fs::path absolute_path = fs::absolute(model_path);
     if (!fs::exists(absolute_path))
@@ -39,6 +41,7 @@ OnnxInferenceBackend::OnnxInferenceBackend(const std::string &model_path)
     }
 
     expected_input_size_ = resolve_expected_input_size();
+    dynamic_batch_ = resolve_dynamic_batch();
 }
 
 std::string OnnxInferenceBackend::backend_name() const
@@ -58,12 +61,42 @@ std::vector<float> OnnxInferenceBackend::reconstruct(const std::vector<float> &i
         throw std::runtime_error("Invalid input size for ONNX backend");
     }
 
-    const std::vector<int64_t> input_shape = {1, static_cast<int64_t>(expected_input_size_)};
+    std::vector<float> output(expected_input_size_);
+    run(input.data(), 1, output.data());
+    return output;
+}
+
+void OnnxInferenceBackend::reconstruct_batch(std::span<const float> input, std::span<float> output)
+{
+    if (input.size() % expected_input_size_ != 0 || output.size() != input.size())
+    {
+        throw std::runtime_error("Invalid batch shape for ONNX backend");
+    }
+
+    const std::size_t rows = input.size() / expected_input_size_;
+    if (dynamic_batch_)
+    {
+        run(input.data(), rows, output.data());
+        return;
+    }
+
+    // Models exported with a fixed batch dimension still skip the per-row vector copies.
+    for (std::size_t row = 0; row < rows; ++row)
+    {
+        const std::size_t offset = row * expected_input_size_;
+        run(input.data() + offset, 1, output.data() + offset);
+    }
+}
+
+void OnnxInferenceBackend::run(const float *input, std::size_t rows, float *output)
+{
+    const std::size_t element_count = rows * expected_input_size_;
+    const std::vector<int64_t> input_shape = {static_cast<int64_t>(rows), static_cast<int64_t>(expected_input_size_)};
 
     Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
         memory_info_,
-        const_cast<float *>(input.data()),
-        input.size(),
+        const_cast<float *>(input),
+        element_count,
         input_shape.data(),
         input_shape.size());
 
@@ -81,14 +114,13 @@ std::vector<float> OnnxInferenceBackend::reconstruct(const std::vector<float> &i
     }
 
     const auto output_info = output_tensors[0].GetTensorTypeAndShapeInfo();
-    const std::size_t element_count = output_info.GetElementCount();
-    if (element_count < expected_input_size_)
+    if (output_info.GetElementCount() < element_count)
     {
         throw std::runtime_error("ONNX output tensor has fewer elements than expected");
     }
 
     const float *output_data = output_tensors[0].GetTensorData<float>();
-    return std::vector<float>(output_data, output_data + expected_input_size_);
+    std::copy_n(output_data, element_count, output);
 }
 
 std::size_t OnnxInferenceBackend::resolve_expected_input_size() const
@@ -114,4 +146,10 @@ std::size_t OnnxInferenceBackend::resolve_expected_input_size() const
 
     return static_cast<std::size_t>(feature_dim);
 }
+
+bool OnnxInferenceBackend::resolve_dynamic_batch() const
+{
+    const auto shape = session_.GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+    return shape.size() > 1 && shape[0] < 0;
+}
 } // namespace ds
@@ -0,0 +1,91 @@
+#include "ReplyBuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ds
+{
+ReplyBuffer::~ReplyBuffer()
+{
+    release_chunks();
+}
+
+void ReplyBuffer::append(std::string_view bytes)
+{
+    while (!bytes.empty())
+    {
+        if (chunks_.empty() || chunks_.back().size == kChunkSize)
+        {
+            chunks_.push_back(Chunk{static_cast<char *>(slab::allocate(kChunkSize)), 0});
+        }
+
+        Chunk &tail = chunks_.back();
+        const std::size_t count = std::min(bytes.size(), kChunkSize - tail.size);
+        std::memcpy(tail.data + tail.size, bytes.data(), count);
+        tail.size += count;
+        size_ += count;
+        bytes.remove_prefix(count);
+    }
+}
+
+std::size_t ReplyBuffer::gather(SlabVector<iovec> &segments, std::size_t max_segments) const
+{
+    std::size_t bytes = 0;
+    std::size_t offset = head_;
+    for (std::size_t i = 0; i < chunks_.size() && i < max_segments; ++i)
+    {
+        const Chunk &chunk = chunks_[i];
+        if (chunk.size > offset)
+        {
+            segments.push_back(iovec{chunk.data + offset, chunk.size - offset});
+            bytes += chunk.size - offset;
+        }
+        offset = 0;
+    }
+
+    return bytes;
+}
+
+void ReplyBuffer::consume(std::size_t bytes)
+{
+    size_ -= bytes;
+    head_ += bytes;
+
+    // Drained connections hand their chunks back, so idle sessions hold no buffers.
+    if (size_ == 0)
+    {
+        release_chunks();
+        head_ = 0;
+        return;
+    }
+
+    // Only full chunks can be sent completely while bytes remain queued behind them.
+    std::size_t sent = 0;
+    while (head_ >= chunks_[sent].size)
+    {
+        head_ -= chunks_[sent].size;
+        slab::deallocate(chunks_[sent].data, kChunkSize);
+        ++sent;
+    }
+    chunks_.erase(chunks_.begin(), chunks_.begin() + static_cast<std::ptrdiff_t>(sent));
+}
+
+bool ReplyBuffer::empty() const
+{
+    return size_ == 0;
+}
+
+std::size_t ReplyBuffer::size() const
+{
+    return size_;
+}
+
+void ReplyBuffer::release_chunks()
+{
+    for (const Chunk &chunk : chunks_)
+    {
+        slab::deallocate(chunk.data, kChunkSize);
+    }
+    chunks_.clear();
+}
+} // namespace ds
@@ -0,0 +1,259 @@
+#include "RequestMetrics.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Logger.hpp"
+#include "SlabPool.hpp"
+
+namespace ds
+{
+namespace
+{
+// Gauges such as open_connections go negative on a thread that closes what another
+// one opened; only the sum over all threads is meaningful.
+struct Counters
+{
+    std::atomic<std::int64_t> throttled_connections{0};
+    std::atomic<std::int64_t> throttle_events{0};
+    std::atomic<std::int64_t> throttled_microseconds{0};
+    std::atomic<std::int64_t> open_connections{0};
+};
+
+using Counter = std::atomic<std::int64_t> Counters::*;
+
+class ThreadCounters;
+
+struct Registry
+{
+    std::mutex mutex;
+    // Live threads and schedulers, and what exited threads left counted.
+    std::vector<const ThreadCounters *> threads;
+    std::vector<QueueDepthGauge *> gauges;
+    Counters retired;
+};
+
+// Never destroyed: connections may still close while the process shuts down.
+Registry &registry()
+{
+    static Registry *instance = new Registry();
+    return *instance;
+}
+
+enum class CountersState
+{
+    Unused,
+    Alive,
+    Destroyed
+};
+
+void add_to(Counters &totals, const Counters &counters)
+{
+    for (const Counter counter : {&Counters::throttled_connections, &Counters::throttle_events,
+                                  &Counters::throttled_microseconds, &Counters::open_connections})
+    {
+        (totals.*counter).fetch_add((counters.*counter).load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+class ThreadCounters
+{
+public:
+    ThreadCounters()
+    {
+        state() = CountersState::Alive;
+        Registry &shared = registry();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        shared.threads.push_back(this);
+    }
+
+    ~ThreadCounters()
+    {
+        state() = CountersState::Destroyed;
+        Registry &shared = registry();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        add_to(shared.retired, counters_);
+        shared.threads.erase(std::find(shared.threads.begin(), shared.threads.end(), this));
+    }
+
+    // Destroyed once the counters are gone; thread_local destructors that run after
+    // them may still close connections, which are then counted as retired.
+    static CountersState &state()
+    {
+        thread_local CountersState state = CountersState::Unused;
+        return state;
+    }
+
+    // Only the owning thread writes its counters, so no read-modify-write is needed.
+    void add(Counter counter, std::int64_t delta)
+    {
+        std::atomic<std::int64_t> &value = counters_.*counter;
+        value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    const Counters &counters() const
+    {
+        return counters_;
+    }
+
+private:
+    Counters counters_;
+};
+
+void count(Counter counter, std::int64_t delta)
+{
+    if (ThreadCounters::state() != CountersState::Destroyed)
+    {
+        thread_local ThreadCounters counters;
+        counters.add(counter, delta);
+        return;
+    }
+
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    (shared.retired.*counter).fetch_add(delta, std::memory_order_relaxed);
+}
+
+std::size_t as_size(const std::atomic<std::int64_t> &total)
+{
+    return static_cast<std::size_t>(std::max<std::int64_t>(total.load(std::memory_order_relaxed), 0));
+}
+} // namespace
+
+RequestMetrics collect_request_metrics()
+{
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+
+    Counters totals;
+    add_to(totals, shared.retired);
+    for (const ThreadCounters *thread : shared.threads)
+    {
+        add_to(totals, thread->counters());
+    }
+
+    RequestMetrics metrics;
+    for (QueueDepthGauge *gauge : shared.gauges)
+    {
+        metrics.queue_depth += gauge->depth();
+        metrics.peak_queue_depth += gauge->take_peak();
+    }
+    metrics.throttled_connections = as_size(totals.throttled_connections);
+    metrics.throttle_events = as_size(totals.throttle_events);
+    metrics.throttled_microseconds = as_size(totals.throttled_microseconds);
+    metrics.open_connections = as_size(totals.open_connections);
+    return metrics;
+}
+
+void count_connection_opened()
+{
+    count(&Counters::open_connections, 1);
+}
+
+void count_connection_closed()
+{
+    count(&Counters::open_connections, -1);
+}
+
+QueueDepthGauge::QueueDepthGauge()
+{
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.gauges.push_back(this);
+}
+
+QueueDepthGauge::~QueueDepthGauge()
+{
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.gauges.erase(std::find(shared.gauges.begin(), shared.gauges.end(), this));
+}
+
+ThrottleTimer::~ThrottleTimer()
+{
+    end();
+}
+
+void ThrottleTimer::begin()
+{
+    if (active_)
+    {
+        return;
+    }
+
+    active_ = true;
+    started_ = std::chrono::steady_clock::now();
+
+    count(&Counters::throttled_connections, 1);
+    count(&Counters::throttle_events, 1);
+}
+
+void ThrottleTimer::end()
+{
+    if (!active_)
+    {
+        return;
+    }
+
+    active_ = false;
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started_);
+
+    count(&Counters::throttled_connections, -1);
+    count(&Counters::throttled_microseconds, elapsed.count());
+}
+
+bool ThrottleTimer::active() const
+{
+    return active_;
+}
+
+MetricsReporter::MetricsReporter(std::chrono::seconds interval)
+    : interval_(interval)
+{
+}
+
+MetricsReporter::~MetricsReporter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    stop_requested_.notify_one();
+
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+void MetricsReporter::start()
+{
+    thread_ = std::thread([this] { run(); });
+}
+
+void MetricsReporter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_requested_.wait_for(lock, interval_, [this] { return stopping_; }))
+    {
+        const RequestMetrics metrics = collect_request_metrics();
+        // Session state lives in the slab pool, so its in-use bytes are what the open
+        // connections cost; slab_bytes is the high-water mark the pool has reserved.
+        const std::size_t connections = metrics.open_connections;
+        const slab::Usage pool = slab::usage();
+        const std::size_t per_connection = connections == 0 ? 0 : pool.in_use_bytes / connections;
+
+        ds::log::info("Metrics: queue_depth=" + std::to_string(metrics.queue_depth) +
+                      " peak_queue_depth=" + std::to_string(metrics.peak_queue_depth) +
+                      " throttled_connections=" + std::to_string(metrics.throttled_connections) +
+                      " throttle_events=" + std::to_string(metrics.throttle_events) +
+                      " throttled_ms=" + std::to_string(metrics.throttled_microseconds / 1000) +
+                      " connections=" + std::to_string(connections) +
+                      " session_bytes=" + std::to_string(pool.in_use_bytes) +
+                      " bytes_per_connection=" + std::to_string(per_connection) +
+                      " slab_bytes=" + std::to_string(pool.reserved_bytes));
+    }
+}
+} // namespace ds
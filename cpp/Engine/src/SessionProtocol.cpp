@@ -0,0 +1,460 @@
+#include "SessionProtocol.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <stdexcept>
+#include <utility>
+
+#include "InputParser.hpp"
+#include "Logger.hpp"
+#include "Lz4Block.hpp"
+
+namespace ds
+{
+namespace
+{
+// A single request line longer than this is treated as a protocol violation.
+constexpr std::size_t kMaxLineLength = 64 * 1024;
+// Limits on one text batch, which is only scored once all of its rows arrived.
+constexpr std::size_t kMaxBatchRows = 4096;
+constexpr std::size_t kMaxBatchBytes = 1024 * 1024;
+
+void append_text_reply(ReplyBuffer &replies, const std::optional<std::uint64_t> &request_id, std::string_view reply)
+{
+    if (request_id)
+    {
+        // "@" + up to 20 digits + " "
+        char tag[22];
+        tag[0] = kRequestIdPrefix;
+        char *end = std::to_chars(tag + 1, tag + sizeof(tag) - 1, *request_id).ptr;
+        *end++ = ' ';
+        replies.append(std::string_view(tag, static_cast<std::size_t>(end - tag)));
+    }
+
+    replies.append(reply);
+}
+} // namespace
+
+SessionProtocol::SessionProtocol(AnomalyDetector &detector,
+                                 std::size_t expected_input_size,
+                                 TaggedDispatch dispatch_tagged,
+                                 TaggedAdmission admit_tagged)
+    : detector_(detector),
+      expected_input_size_(expected_input_size),
+      dispatch_tagged_(std::move(dispatch_tagged)),
+      admit_tagged_(std::move(admit_tagged)),
+      values_(expected_input_size)
+{
+}
+
+std::size_t SessionProtocol::consume(std::string_view input, ReplyBuffer &replies)
+{
+    stalled_ = false;
+    awaiting_batch_ = false;
+
+    std::size_t consumed = 0;
+    if (wire_mode_ == WireMode::Undecided)
+    {
+        consumed = negotiate_wire_mode(input, replies);
+    }
+
+    if (wire_mode_ == WireMode::Text)
+    {
+        consumed += consume_lines(input.substr(consumed), replies);
+        if (awaiting_batch_ && input.size() - consumed > kMaxBatchBytes)
+        {
+            throw std::runtime_error("Request batch exceeds " + std::to_string(kMaxBatchBytes) + " bytes");
+        }
+        if (!stalled_ && !awaiting_batch_ && input.size() - consumed > kMaxLineLength)
+        {
+            throw std::runtime_error("Request line exceeds " + std::to_string(kMaxLineLength) + " bytes");
+        }
+    }
+    else if (wire_mode_ == WireMode::Binary)
+    {
+        consumed += consume_frames(input.substr(consumed), replies);
+    }
+
+    return consumed;
+}
+
+std::size_t SessionProtocol::negotiate_wire_mode(std::string_view input, ReplyBuffer &replies)
+{
+    switch (wire::match_binary_magic(input))
+    {
+    case wire::MagicMatch::Incomplete:
+        return 0;
+    case wire::MagicMatch::Binary:
+        replies.append(std::string_view(wire::kBinaryMagic.data(), wire::kBinaryMagic.size()));
+        wire_mode_ = WireMode::Binary;
+        ds::log::info("Client negotiated binary framing");
+        return wire::kBinaryMagic.size();
+    case wire::MagicMatch::Text:
+        wire_mode_ = WireMode::Text;
+        return 0;
+    }
+
+    return 0;
+}
+
+std::size_t SessionProtocol::consume_lines(std::string_view text, ReplyBuffer &replies)
+{
+    // Tokenize every complete line at once, then score all valid ones in one batch.
+    BatchScratch &scratch = batch_scratch();
+    tokenize_lines(text, scratch.tokenized);
+
+    scratch.inputs.resize(scratch.tokenized.lines.size() * expected_input_size_);
+    scratch.line_records.clear();
+
+    const std::span<const TextLine> lines(scratch.tokenized.lines);
+    std::size_t consumed = scratch.tokenized.consumed;
+    std::size_t rows = 0;
+    std::size_t batch_rows_left = 0;
+    for (std::size_t i = 0; i < lines.size(); ++i)
+    {
+        const TextLine &line = lines[i];
+        const auto tokens = std::span<const TextToken>(scratch.tokenized.tokens).subspan(line.first_token,
+                                                                                         line.token_count);
+        const bool in_batch = batch_rows_left > 0;
+        std::size_t batch_rows = 0;
+        if (!in_batch && parse_batch_header(text, tokens, batch_rows))
+        {
+            if (batch_rows > 0 && batch_rows <= kMaxBatchRows && lines.size() - i - 1 < batch_rows)
+            {
+                // Score the batch only once all of its rows are here.
+                awaiting_batch_ = true;
+                consumed = line.offset;
+                break;
+            }
+
+            ds::log::debug([&] { return "Received raw: " + std::string(text.substr(line.offset, line.length)); });
+            if (batch_rows == 0 || batch_rows > kMaxBatchRows)
+            {
+                ds::log::error("Malformed batch header");
+                scratch.line_records.push_back(LineRecord{LineOutcome::MalformedBatchHeader, std::nullopt});
+                continue;
+            }
+
+            batch_rows_left = batch_rows;
+            scratch.line_records.push_back(LineRecord{LineOutcome::BatchHeader, std::nullopt, batch_rows});
+            continue;
+        }
+
+        const bool tagged = !tokens.empty() && text[tokens.front().offset] == kRequestIdPrefix;
+        if (!in_batch && tagged && !admit_tagged())
+        {
+            // Leave this line and everything after it for when requests have drained.
+            stalled_ = true;
+            consumed = line.offset;
+            break;
+        }
+
+        ds::log::debug([&] { return "Received raw: " + std::string(text.substr(line.offset, line.length)); });
+
+        const auto row = std::span<float>(scratch.inputs).subspan(rows * expected_input_size_, expected_input_size_);
+        std::optional<std::uint64_t> request_id;
+        LineOutcome outcome = parse_line(text, scratch.tokenized, line, row, request_id);
+
+        if (in_batch)
+        {
+            --batch_rows_left;
+            // Batch rows are answered in place inside the block, so they carry no tag.
+            if (request_id)
+            {
+                ds::log::error("Tagged request inside a batch");
+                outcome = LineOutcome::Malformed;
+                request_id.reset();
+            }
+        }
+
+        if (outcome == LineOutcome::Valid && request_id)
+        {
+            dispatch(*request_id, std::vector<float>(row.begin(), row.end()));
+            outcome = LineOutcome::Dispatched;
+        }
+        else if (outcome == LineOutcome::Valid)
+        {
+            ++rows;
+        }
+
+        scratch.line_records.push_back(LineRecord{outcome, request_id});
+    }
+
+    scratch.results.resize(rows);
+    detector_.evaluate_batch(std::span<const float>(scratch.inputs.data(), rows * expected_input_size_),
+                             scratch.results);
+
+    std::size_t row = 0;
+    for (const LineRecord &record : scratch.line_records)
+    {
+        switch (record.outcome)
+        {
+        case LineOutcome::Dispatched:
+            break;
+        case LineOutcome::Malformed:
+            append_text_reply(replies, record.request_id, "ERROR: Malformed input\n");
+            break;
+        case LineOutcome::InvalidSize:
+            append_text_reply(replies, record.request_id, "ERROR: Invalid input size\n");
+            break;
+        case LineOutcome::BatchHeader:
+        {
+            // "BATCH " + up to 20 digits + "\n"
+            char header[kBatchKeyword.size() + 22];
+            char *end = std::copy(kBatchKeyword.begin(), kBatchKeyword.end(), header);
+            *end++ = ' ';
+            end = std::to_chars(end, header + sizeof(header) - 1, record.batch_rows).ptr;
+            *end++ = '\n';
+            replies.append(std::string_view(header, static_cast<std::size_t>(end - header)));
+            break;
+        }
+        case LineOutcome::MalformedBatchHeader:
+            replies.append("ERROR: Malformed batch header\n");
+            break;
+        case LineOutcome::Valid:
+        {
+            const DetectionResult &result = scratch.results[row++];
+            ds::log::debug([&] { return "Reconstruction MSE: " + std::to_string(result.mse); });
+
+            const std::string_view response = result.response_line();
+            ds::log::debug([&] { return "Sending response: " + std::string(response); });
+            replies.append(response);
+            break;
+        }
+        }
+    }
+
+    return consumed;
+}
+
+SessionProtocol::LineOutcome SessionProtocol::parse_line(std::string_view text,
+                                                         const TokenizedText &tokenized,
+                                                         const TextLine &line,
+                                                         std::span<float> output,
+                                                         std::optional<std::uint64_t> &request_id) const
+{
+    const auto tokens = std::span<const TextToken>(tokenized.tokens).subspan(line.first_token, line.token_count);
+    const ParseResult parsed = parse_request_line(text, tokens, output, request_id);
+
+    if (parsed.status == ParseStatus::Malformed)
+    {
+        ds::log::error("Malformed input after " + std::to_string(parsed.count) + " values");
+        return LineOutcome::Malformed;
+    }
+
+    if (parsed.status == ParseStatus::TooManyValues || parsed.count != expected_input_size_)
+    {
+        const std::size_t value_count = line.token_count - (request_id ? 1 : 0);
+        ds::log::error("Invalid input size. Expected " + std::to_string(expected_input_size_) +
+                       ", got " + std::to_string(value_count));
+        return LineOutcome::InvalidSize;
+    }
+
+    return LineOutcome::Valid;
+}
+
+std::size_t SessionProtocol::consume_frames(std::string_view data, ReplyBuffer &replies)
+{
+    const char *begin = data.data();
+    const std::size_t size = data.size();
+
+    std::size_t offset = 0;
+    while (size - offset >= wire::kFrameHeaderSize)
+    {
+        const std::size_t frame_offset = offset;
+        const wire::FrameHeader header = wire::decode_frame_header(begin + offset);
+        if (!header.valid())
+        {
+            throw std::runtime_error("Malformed binary frame header");
+        }
+
+        std::size_t frame_size = wire::kFrameHeaderSize + header.payload_size();
+        if (size - offset < frame_size)
+        {
+            break;
+        }
+
+        const char *payload = begin + offset + wire::kFrameHeaderSize;
+        if (header.batch())
+        {
+            const std::uint32_t body_size = wire::decode_body_size(payload);
+            if (body_size > wire::kMaxBatchBodySize)
+            {
+                throw std::runtime_error("Binary batch body exceeds " + std::to_string(wire::kMaxBatchBodySize) +
+                                         " bytes");
+            }
+
+            frame_size += body_size;
+            if (size - offset < frame_size)
+            {
+                break;
+            }
+
+            offset += frame_size;
+            score_batch_frame(header, std::string_view(payload + wire::kBodySizeSize, body_size), replies);
+            continue;
+        }
+
+        offset += frame_size;
+
+        std::optional<std::uint64_t> request_id;
+        if (header.tagged())
+        {
+            request_id = wire::decode_request_id(payload);
+            payload += wire::kRequestIdSize;
+        }
+
+        if (header.count != expected_input_size_)
+        {
+            ds::log::error("Invalid input size. Expected " + std::to_string(expected_input_size_) +
+                           ", got " + std::to_string(header.count));
+            if (request_id)
+            {
+                wire::append_tagged_reply(replies, *request_id, wire::ReplyStatus::Error, 0.0);
+            }
+            else
+            {
+                wire::append_reply(replies, wire::ReplyStatus::Error, 0.0);
+            }
+            continue;
+        }
+
+        if (request_id && !admit_tagged())
+        {
+            stalled_ = true;
+            offset = frame_offset;
+            break;
+        }
+
+        if (request_id)
+        {
+            std::vector<float> values(expected_input_size_);
+            wire::decode_frame_values(header, payload, values);
+            dispatch(*request_id, std::move(values));
+            continue;
+        }
+
+        wire::decode_frame_values(header, payload, values_);
+
+        const auto result = detector_.evaluate(values_);
+        ds::log::debug([&] { return "Reconstruction MSE: " + std::to_string(result.mse); });
+
+        wire::append_reply(replies, wire::to_reply_status(result.status), result.mse);
+    }
+
+    return offset;
+}
+
+void SessionProtocol::score_batch_frame(const wire::FrameHeader &header, std::string_view body, ReplyBuffer &replies)
+{
+    BatchScratch &scratch = batch_scratch();
+    const std::size_t rows = header.count;
+    const std::size_t raw_size = wire::batch_body_size(header.encoding, rows, expected_input_size_);
+    if (raw_size > wire::kMaxBatchBodySize || (!header.compressed() && body.size() != raw_size))
+    {
+        throw std::runtime_error("Malformed binary batch frame");
+    }
+
+    ds::log::debug([&] {
+        return "Received binary batch: " + std::to_string(rows) + " rows, " + std::to_string(body.size()) +
+               (header.compressed() ? " compressed bytes" : " bytes");
+    });
+
+    scratch.inputs.resize(rows * expected_input_size_);
+    const std::span<float> inputs(scratch.inputs);
+    if (header.compressed())
+    {
+        if (header.encoding == wire::Encoding::Float32 && std::endian::native == std::endian::little)
+        {
+            // Float32 rows already have the in-memory layout, so they are decompressed
+            // straight into the batch input.
+            if (!lz4::decompress(body, std::span<char>(reinterpret_cast<char *>(inputs.data()), raw_size)))
+            {
+                throw std::runtime_error("Malformed compressed batch body");
+            }
+            body = {};
+        }
+        else
+        {
+            scratch.packed.resize(raw_size);
+            if (!lz4::decompress(body, scratch.packed))
+            {
+                throw std::runtime_error("Malformed compressed batch body");
+            }
+            body = std::string_view(scratch.packed.data(), raw_size);
+        }
+    }
+
+    if (!body.empty())
+    {
+        wire::decode_frame_values(header, body.data(), inputs);
+    }
+
+    scratch.results.resize(rows);
+    detector_.evaluate_batch(inputs, scratch.results);
+    wire::append_batch_reply(replies, scratch.results, header.compressed());
+}
+
+SessionProtocol::BatchScratch &SessionProtocol::batch_scratch()
+{
+    thread_local BatchScratch scratch;
+    return scratch;
+}
+
+bool SessionProtocol::admit_tagged() const
+{
+    return !admit_tagged_ || admit_tagged_(tagged_in_flight_);
+}
+
+void SessionProtocol::dispatch(std::uint64_t request_id, std::vector<float> values)
+{
+    ++tagged_in_flight_;
+    dispatch_tagged_(request_id, std::move(values));
+}
+
+void SessionProtocol::complete_tagged(std::uint64_t request_id,
+                                      std::exception_ptr error,
+                                      const DetectionResult &result,
+                                      ReplyBuffer &replies)
+{
+    --tagged_in_flight_;
+
+    if (error)
+    {
+        try
+        {
+            std::rethrow_exception(error);
+        }
+        catch (const std::exception &ex)
+        {
+            ds::log::error("Inference failed for request " + std::to_string(request_id) + ": " + ex.what());
+        }
+    }
+    else
+    {
+        ds::log::debug([&] { return "Reconstruction MSE: " + std::to_string(result.mse); });
+    }
+
+    if (wire_mode_ == WireMode::Binary)
+    {
+        const auto status = error ? wire::ReplyStatus::Error : wire::to_reply_status(result.status);
+        wire::append_tagged_reply(replies, request_id, status, error ? 0.0 : result.mse);
+    }
+    else
+    {
+        append_text_reply(replies, request_id, error ? std::string_view("ERROR: Inference failed\n")
+                                                      : result.response_line());
+    }
+}
+
+std::size_t SessionProtocol::tagged_in_flight() const
+{
+    return tagged_in_flight_;
+}
+
+bool SessionProtocol::stalled() const
+{
+    return stalled_;
+}
+} // namespace ds
@@ -0,0 +1,169 @@
+#include "ShardedTcpServer.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "BusyPoll.hpp"
+#include "ClientSession.hpp"
+#include "Logger.hpp"
+
+using boost::asio::ip::tcp;
+
+namespace ds
+{
+namespace
+{
+using reuse_port = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+void pin_to_core(std::size_t core)
+{
+    const unsigned int cores = std::thread::hardware_concurrency();
+    if (cores == 0)
+    {
+        return;
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core % cores, &cpus);
+    if (::pthread_setaffinity_np(::pthread_self(), sizeof(cpus), &cpus) != 0)
+    {
+        ds::log::error("Failed to pin shard thread to core " + std::to_string(core % cores));
+    }
+}
+} // namespace
+
+ShardedTcpServer::Shard::Shard(std::uint16_t port,
+                               std::unique_ptr<IInferenceBackend> shard_backend,
+                               double threshold,
+                               InFlightLimits limits,
+                               std::chrono::seconds idle_timeout)
+    : backend(std::move(shard_backend)),
+      detector(*backend, threshold),
+      io_context(1),
+      // Tagged requests are scored between I/O completions on the shard's own thread.
+      scheduler(detector, io_context.get_executor(), limits),
+      acceptor(io_context),
+      idle_tick(io_context)
+{
+    if (idle_timeout.count() > 0)
+    {
+        idle_timer.emplace(idle_timeout);
+    }
+
+    const tcp::endpoint endpoint(tcp::v4(), port);
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(tcp::acceptor::reuse_address(true));
+    acceptor.set_option(reuse_port(true));
+    acceptor.bind(endpoint);
+    acceptor.listen();
+}
+
+ShardedTcpServer::ShardedTcpServer(std::uint16_t port,
+                                   std::size_t shard_count,
+                                   const BackendFactory &create_backend,
+                                   double threshold,
+                                   InFlightLimits limits,
+                                   std::chrono::microseconds busy_poll,
+                                   std::chrono::seconds idle_timeout)
+    : port_(port),
+      busy_poll_(busy_poll)
+{
+    if (shard_count == 0)
+    {
+        throw std::runtime_error("Sharded TCP server needs at least one shard");
+    }
+
+    shards_.reserve(shard_count);
+    for (std::size_t i = 0; i < shard_count; ++i)
+    {
+        shards_.push_back(std::make_unique<Shard>(port_, create_backend(), threshold, limits, idle_timeout));
+    }
+}
+
+ShardedTcpServer::~ShardedTcpServer() = default;
+
+void ShardedTcpServer::run()
+{
+    ds::log::info("Server listening on port " + std::to_string(port_) + " with " + std::to_string(shards_.size()) +
+                  " SO_REUSEPORT shards");
+
+    std::vector<std::thread> workers;
+    workers.reserve(shards_.size() - 1);
+    for (std::size_t i = 0; i < shards_.size(); ++i)
+    {
+        Shard &shard = *shards_[i];
+        do_accept(shard);
+        if (shard.idle_timer)
+        {
+            do_idle_tick(shard);
+        }
+
+        const auto serve = [this, &shard, i] {
+            pin_to_core(i);
+            run_busy_polling(shard.io_context, busy_poll_);
+        };
+
+        if (i + 1 < shards_.size())
+        {
+            workers.emplace_back(serve);
+        }
+        else
+        {
+            serve();
+        }
+    }
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ShardedTcpServer::do_accept(Shard &shard)
+{
+    // A shard runs on a single thread, so its sessions need no strands.
+    shard.acceptor.async_accept([this, &shard](const boost::system::error_code &ec, tcp::socket socket) {
+        if (ec)
+        {
+            ds::log::error("Accept failed: " + ec.message());
+        }
+        else
+        {
+            boost::system::error_code endpoint_ec;
+            const auto endpoint = socket.remote_endpoint(endpoint_ec);
+            std::string peer = endpoint_ec ? std::string("unknown") : endpoint.address().to_string();
+            enable_socket_busy_poll(socket.native_handle(), busy_poll_);
+
+            ClientSession::create(ClientSession::Socket(std::move(socket)),
+                                  std::move(peer),
+                                  shard.detector,
+                                  shard.scheduler,
+                                  shard.backend->expected_input_size(),
+                                  shard.idle_timer ? &*shard.idle_timer : nullptr)
+                ->start();
+        }
+
+        do_accept(shard);
+    });
+}
+
+void ShardedTcpServer::do_idle_tick(Shard &shard)
+{
+    shard.idle_tick.expires_after(shard.idle_timer->tick());
+    shard.idle_tick.async_wait([this, &shard](const boost::system::error_code &ec) {
+        if (ec)
+        {
+            return;
+        }
+
+        shard.idle_timer->advance(&ClientSession::expire_idle);
+        do_idle_tick(shard);
+    });
+}
+} // namespace ds
@@ -0,0 +1,150 @@
+#include "ShmClient.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace ds
+{
+ShmClient::ShmClient(const std::string &name, std::chrono::microseconds spin_duration)
+    : spin_duration_(spin_duration)
+{
+    const int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open shared memory region " + name + ": " + std::strerror(errno));
+    }
+
+    void *mapping = ::mmap(nullptr, sizeof(shm::Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("Failed to map shared memory region " + name + ": " + std::strerror(errno));
+    }
+
+    region_ = static_cast<shm::Region *>(mapping);
+    if (region_->magic.load(std::memory_order_acquire) != shm::kRegionMagic ||
+        region_->version != shm::kRegionVersion)
+    {
+        ::munmap(region_, sizeof(shm::Region));
+        throw std::runtime_error("Shared memory region " + name + " is not a DataSentinel engine region");
+    }
+
+    for (auto &channel : region_->channels)
+    {
+        std::int32_t unowned = 0;
+        if (channel.owner_pid.compare_exchange_strong(unowned, static_cast<std::int32_t>(::getpid())))
+        {
+            channel.state.store(shm::ChannelState::Claiming, std::memory_order_release);
+            channel.requests.reset();
+            channel.responses.reset();
+            channel.state.store(shm::ChannelState::Active, std::memory_order_release);
+            channel_ = &channel;
+            break;
+        }
+    }
+
+    if (channel_ == nullptr)
+    {
+        ::munmap(region_, sizeof(shm::Region));
+        throw std::runtime_error("All shared memory channels of " + name + " are in use");
+    }
+}
+
+ShmClient::~ShmClient()
+{
+    // The engine returns the channel to the free list once it stops reading it.
+    channel_->state.store(shm::ChannelState::Released, std::memory_order_release);
+    region_->engine_doorbell.notify();
+    ::munmap(region_, sizeof(shm::Region));
+}
+
+std::size_t ShmClient::expected_input_size() const
+{
+    return region_->expected_input_size;
+}
+
+bool ShmClient::try_submit(std::uint64_t request_id, std::span<const float> values)
+{
+    if (values.size() > shm::kMaxValues)
+    {
+        throw std::invalid_argument("Shared memory requests carry at most " + std::to_string(shm::kMaxValues) +
+                                    " values");
+    }
+
+    shm::RequestSlot *slot = channel_->requests.producer_slot();
+    if (slot == nullptr)
+    {
+        return false;
+    }
+
+    slot->request_id = request_id;
+    slot->count = static_cast<std::uint32_t>(values.size());
+    std::copy(values.begin(), values.end(), slot->values);
+    channel_->requests.publish();
+    region_->engine_doorbell.notify();
+    return true;
+}
+
+bool ShmClient::try_receive(ShmReply &reply)
+{
+    const shm::ResponseSlot *slot = channel_->responses.consumer_slot();
+    if (slot == nullptr)
+    {
+        return false;
+    }
+
+    reply = ShmReply{slot->request_id, slot->status, slot->mse};
+    channel_->responses.release();
+    return true;
+}
+
+ShmReply ShmClient::receive()
+{
+    ShmReply reply{};
+    const auto spin_until = std::chrono::steady_clock::now() + spin_duration_;
+    while (std::chrono::steady_clock::now() < spin_until)
+    {
+        if (try_receive(reply))
+        {
+            return reply;
+        }
+    }
+
+    shm::Doorbell &doorbell = channel_->client_doorbell;
+    while (true)
+    {
+        const std::uint32_t seen = doorbell.prepare_wait();
+        if (try_receive(reply))
+        {
+            doorbell.cancel_wait();
+            return reply;
+        }
+        doorbell.wait(seen, shm::to_timespec(100'000));
+    }
+}
+
+ShmReply ShmClient::evaluate(std::span<const float> values)
+{
+    const std::uint64_t request_id = next_request_id_++;
+    while (!try_submit(request_id, values))
+    {
+        ShmReply stale{};
+        try_receive(stale);
+    }
+
+    while (true)
+    {
+        const ShmReply reply = receive();
+        if (reply.request_id == request_id)
+        {
+            return reply;
+        }
+    }
+}
+} // namespace ds
@@ -0,0 +1,219 @@
+#include "ShmServer.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <new>
+#include <span>
+#include <stdexcept>
+
+#include "Logger.hpp"
+
+namespace ds
+{
+namespace
+{
+// How long the engine sleeps on the doorbell before rechecking for dead clients.
+constexpr std::uint64_t kIdleWaitMicroseconds = 100'000;
+
+bool process_alive(std::int32_t pid)
+{
+    return pid > 0 && (::kill(pid, 0) == 0 || errno != ESRCH);
+}
+} // namespace
+
+ShmServer::ShmServer(const std::string &name,
+                     AnomalyDetector &detector,
+                     std::size_t expected_input_size,
+                     std::chrono::microseconds spin_duration)
+    : name_(name),
+      detector_(detector),
+      expected_input_size_(expected_input_size),
+      spin_duration_(spin_duration)
+{
+    if (expected_input_size_ == 0 || expected_input_size_ > shm::kMaxValues)
+    {
+        throw std::runtime_error("Shared memory transport supports at most " + std::to_string(shm::kMaxValues) +
+                                 " input values per request");
+    }
+
+    // A region left behind by a crashed engine is replaced.
+    ::shm_unlink(name_.c_str());
+
+    const int fd = ::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0660);
+    if (fd < 0)
+    {
+        throw std::runtime_error("shm_open failed for " + name_ + ": " + std::strerror(errno));
+    }
+
+    if (::ftruncate(fd, sizeof(shm::Region)) != 0)
+    {
+        const std::string reason = std::strerror(errno);
+        ::close(fd);
+        ::shm_unlink(name_.c_str());
+        throw std::runtime_error("Failed to size shared memory region " + name_ + ": " + reason);
+    }
+
+    void *mapping = ::mmap(nullptr, sizeof(shm::Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        ::shm_unlink(name_.c_str());
+        throw std::runtime_error("Failed to map shared memory region " + name_ + ": " + std::strerror(errno));
+    }
+
+    region_ = new (mapping) shm::Region();
+    region_->expected_input_size = static_cast<std::uint32_t>(expected_input_size_);
+    // Clients check the magic before touching anything else.
+    region_->magic.store(shm::kRegionMagic, std::memory_order_release);
+}
+
+ShmServer::~ShmServer()
+{
+    stop_requested_.store(true);
+    if (thread_.joinable())
+    {
+        region_->engine_doorbell.notify();
+        thread_.join();
+    }
+
+    ::munmap(region_, sizeof(shm::Region));
+    ::shm_unlink(name_.c_str());
+}
+
+void ShmServer::start()
+{
+    ds::log::info("Shared memory transport listening on " + name_);
+    thread_ = std::thread([this] { run(); });
+}
+
+void ShmServer::run()
+{
+    auto last_activity = std::chrono::steady_clock::now();
+
+    while (!stop_requested_.load(std::memory_order_relaxed))
+    {
+        bool processed = false;
+        for (auto &channel : region_->channels)
+        {
+            if (channel.state.load(std::memory_order_acquire) == shm::ChannelState::Active)
+            {
+                processed |= drain_channel(channel);
+            }
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (processed)
+        {
+            last_activity = now;
+            continue;
+        }
+
+        // Spin for a while after the last request; then sleep until a client rings.
+        if (now - last_activity < spin_duration_)
+        {
+            continue;
+        }
+
+        recycle_channels();
+
+        shm::Doorbell &doorbell = region_->engine_doorbell;
+        const std::uint32_t seen = doorbell.prepare_wait();
+        if (has_pending_requests() || stop_requested_.load())
+        {
+            doorbell.cancel_wait();
+            continue;
+        }
+
+        doorbell.wait(seen, shm::to_timespec(kIdleWaitMicroseconds));
+    }
+}
+
+bool ShmServer::drain_channel(shm::Channel &channel)
+{
+    bool processed = false;
+
+    while (const shm::RequestSlot *request = channel.requests.consumer_slot())
+    {
+        // Leave the request queued until the client has made room for its reply.
+        shm::ResponseSlot *response = channel.responses.producer_slot();
+        if (response == nullptr)
+        {
+            break;
+        }
+
+        response->request_id = request->request_id;
+        if (request->count != expected_input_size_)
+        {
+            response->status = wire::ReplyStatus::Error;
+            response->mse = 0.0;
+        }
+        else
+        {
+            DetectionResult result{.mse = 0.0, .status = DetectionStatus::Ok};
+            try
+            {
+                detector_.evaluate_batch(std::span<const float>(request->values, expected_input_size_),
+                                         std::span<DetectionResult>(&result, 1));
+                response->status = wire::to_reply_status(result.status);
+                response->mse = result.mse;
+            }
+            catch (const std::exception &ex)
+            {
+                ds::log::error(std::string("Shared memory request failed: ") + ex.what());
+                response->status = wire::ReplyStatus::Error;
+                response->mse = 0.0;
+            }
+        }
+
+        channel.requests.release();
+        channel.responses.publish();
+        processed = true;
+    }
+
+    if (processed)
+    {
+        channel.client_doorbell.notify();
+    }
+
+    return processed;
+}
+
+void ShmServer::recycle_channels()
+{
+    for (auto &channel : region_->channels)
+    {
+        const auto state = channel.state.load(std::memory_order_acquire);
+        const std::int32_t owner = channel.owner_pid.load();
+        // A client that died right after taking the pid leaves the state at Free.
+        const bool abandoned = state != shm::ChannelState::Released && owner != 0 && !process_alive(owner);
+
+        if (state == shm::ChannelState::Released || abandoned)
+        {
+            if (abandoned)
+            {
+                ds::log::info("Reclaiming shared memory channel of exited process " + std::to_string(owner));
+            }
+            // Clearing the owner reopens the channel to clients, so it goes last.
+            channel.state.store(shm::ChannelState::Free, std::memory_order_release);
+            channel.owner_pid.store(0);
+        }
+    }
+}
+
+bool ShmServer::has_pending_requests() const
+{
+    for (const auto &channel : region_->channels)
+    {
+        if (channel.state.load(std::memory_order_acquire) == shm::ChannelState::Active && !channel.requests.empty())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace ds
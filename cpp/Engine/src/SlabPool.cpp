@@ -0,0 +1,259 @@
+#include "SlabPool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace ds::slab
+{
+namespace
+{
+constexpr std::size_t kClassCount = std::bit_width(kMaxBlockSize / kMinBlockSize);
+constexpr std::align_val_t kSlabAlignment{kMinBlockSize};
+// Free bytes one thread keeps per size class; past this half of them go to the depot.
+constexpr std::size_t kThreadCacheBytes = 256 * 1024;
+
+struct FreeBlock
+{
+    FreeBlock *next;
+};
+
+struct FreeList
+{
+    FreeBlock *head{nullptr};
+    std::size_t count{0};
+
+    void push(void *block) noexcept
+    {
+        auto *free_block = static_cast<FreeBlock *>(block);
+        free_block->next = head;
+        head = free_block;
+        ++count;
+    }
+
+    void *pop() noexcept
+    {
+        FreeBlock *block = head;
+        head = block->next;
+        --count;
+        return block;
+    }
+
+    // Moves up to `limit` blocks from the front of this list onto `target`.
+    void move_to(FreeList &target, std::size_t limit) noexcept
+    {
+        for (; limit > 0 && head != nullptr; --limit)
+        {
+            target.push(pop());
+        }
+    }
+};
+
+class ThreadCache;
+
+// Slabs and oversized blocks are rare enough to count in shared atomics.
+std::atomic<std::size_t> reserved_bytes{0};
+std::atomic<std::size_t> oversized_bytes{0};
+
+struct Depot
+{
+    std::mutex mutex;
+    std::array<FreeList, kClassCount> lists;
+    // Live caches, for usage(), and what exited threads left counted.
+    std::vector<const ThreadCache *> caches;
+    std::int64_t retired_in_use{0};
+};
+
+// Never destroyed: blocks may still be freed while the process shuts down.
+Depot &depot()
+{
+    static Depot *instance = new Depot();
+    return *instance;
+}
+
+std::size_t class_index(std::size_t bytes)
+{
+    return bytes <= kMinBlockSize ? 0 : std::bit_width((bytes - 1) / kMinBlockSize);
+}
+
+std::size_t class_size(std::size_t index)
+{
+    return kMinBlockSize << index;
+}
+
+std::size_t cache_limit(std::size_t index)
+{
+    return kThreadCacheBytes / class_size(index);
+}
+
+enum class CacheState
+{
+    Unused,
+    Alive,
+    Destroyed
+};
+
+class ThreadCache
+{
+public:
+    ThreadCache()
+    {
+        state() = CacheState::Alive;
+        Depot &shared = depot();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        shared.caches.push_back(this);
+    }
+
+    ~ThreadCache()
+    {
+        state() = CacheState::Destroyed;
+        Depot &shared = depot();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        for (std::size_t index = 0; index < kClassCount; ++index)
+        {
+            lists_[index].move_to(shared.lists[index], lists_[index].count);
+        }
+        shared.retired_in_use += in_use();
+        shared.caches.erase(std::find(shared.caches.begin(), shared.caches.end(), this));
+    }
+
+    // Bytes this thread handed out minus those it took back; blocks freed on another
+    // thread make single caches go negative, only the sum is meaningful.
+    std::int64_t in_use() const
+    {
+        return in_use_.load(std::memory_order_relaxed);
+    }
+
+    // Destroyed once the cache is gone; thread_local destructors that run after it
+    // may still free blocks, which then go straight to the depot.
+    static CacheState &state()
+    {
+        thread_local CacheState state = CacheState::Unused;
+        return state;
+    }
+
+    void *allocate(std::size_t index)
+    {
+        FreeList &list = lists_[index];
+        if (list.head == nullptr)
+        {
+            refill(index);
+        }
+        count(static_cast<std::int64_t>(class_size(index)));
+        return list.pop();
+    }
+
+    void deallocate(void *block, std::size_t index) noexcept
+    {
+        count(-static_cast<std::int64_t>(class_size(index)));
+        FreeList &list = lists_[index];
+        list.push(block);
+        if (list.count > cache_limit(index))
+        {
+            Depot &shared = depot();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            list.move_to(shared.lists[index], list.count / 2);
+        }
+    }
+
+private:
+    // Only the owning thread writes its counter, so no read-modify-write is needed.
+    void count(std::int64_t bytes) noexcept
+    {
+        in_use_.store(in_use_.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    }
+
+    void refill(std::size_t index)
+    {
+        FreeList &list = lists_[index];
+        {
+            Depot &shared = depot();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            shared.lists[index].move_to(list, cache_limit(index) / 2);
+        }
+        if (list.head != nullptr)
+        {
+            return;
+        }
+
+        const std::size_t size = class_size(index);
+        char *slab = static_cast<char *>(::operator new(kSlabSize, kSlabAlignment));
+        reserved_bytes.fetch_add(kSlabSize, std::memory_order_relaxed);
+        for (std::size_t offset = kSlabSize; offset >= size; offset -= size)
+        {
+            list.push(slab + offset - size);
+        }
+    }
+
+    std::array<FreeList, kClassCount> lists_;
+    std::atomic<std::int64_t> in_use_{0};
+};
+
+ThreadCache &thread_cache()
+{
+    thread_local ThreadCache cache;
+    return cache;
+}
+} // namespace
+
+void *allocate(std::size_t bytes)
+{
+    if (bytes > kMaxBlockSize)
+    {
+        void *block = ::operator new(bytes, kSlabAlignment);
+        oversized_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        return block;
+    }
+
+    return thread_cache().allocate(class_index(bytes));
+}
+
+void deallocate(void *block, std::size_t bytes) noexcept
+{
+    if (block == nullptr)
+    {
+        return;
+    }
+
+    if (bytes > kMaxBlockSize)
+    {
+        ::operator delete(block, kSlabAlignment);
+        oversized_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        return;
+    }
+
+    const std::size_t index = class_index(bytes);
+    if (ThreadCache::state() != CacheState::Destroyed)
+    {
+        thread_cache().deallocate(block, index);
+        return;
+    }
+
+    Depot &shared = depot();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.lists[index].push(block);
+    shared.retired_in_use -= static_cast<std::int64_t>(class_size(index));
+}
+
+Usage usage()
+{
+    Depot &shared = depot();
+    std::int64_t in_use = 0;
+    {
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        in_use = shared.retired_in_use;
+        for (const ThreadCache *cache : shared.caches)
+        {
+            in_use += cache->in_use();
+        }
+    }
+
+    const std::size_t oversized = oversized_bytes.load(std::memory_order_relaxed);
+    return Usage{reserved_bytes.load(std::memory_order_relaxed) + oversized,
+                 static_cast<std::size_t>(std::max<std::int64_t>(in_use, 0)) + oversized};
+}
+} // namespace ds::slab
@@ -1,33 +1,302 @@
 #include "TcpServer.hpp"
 
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "BusyPoll.hpp"
 #include "ClientSession.hpp"
 #include "Logger.hpp"
+#include "ThreadCount.hpp"
 
 using boost::asio::ip::tcp;
+using boost::asio::local::stream_protocol;
 
 namespace ds
 {
+namespace
+{
+constexpr std::size_t kMinSessionPrune = 64;
+// How often a draining server checks whether its last connection has closed.
+constexpr std::chrono::milliseconds kDrainCheckInterval{100};
+} // namespace
+
 TcpServer::TcpServer(std::uint16_t port,
                      AnomalyDetector &detector,
-                     std::size_t expected_input_size)
-    : io_context_(),
-      acceptor_(io_context_, tcp::endpoint(tcp::v4(), port)),
+                     InferenceScheduler &scheduler,
+                     std::size_t expected_input_size,
+                     std::size_t worker_threads,
+                     const std::string &unix_socket_path,
+                     std::chrono::microseconds busy_poll,
+                     std::chrono::seconds idle_timeout,
+                     Listeners inherited)
+    : io_context_(static_cast<int>(resolve_thread_count(worker_threads))),
+      accept_strand_(boost::asio::make_strand(io_context_)),
+      acceptor_(accept_strand_),
+      unix_socket_path_(unix_socket_path),
       detector_(detector),
-      expected_input_size_(expected_input_size)
+      scheduler_(scheduler),
+      expected_input_size_(expected_input_size),
+      worker_threads_(resolve_thread_count(worker_threads)),
+      busy_poll_(busy_poll),
+      idle_tick_(accept_strand_),
+      prune_at_(kMinSessionPrune),
+      drain_timer_(accept_strand_)
 {
+    if (idle_timeout.count() > 0)
+    {
+        idle_timer_.emplace(idle_timeout);
+    }
+
+    if (inherited.tcp >= 0)
+    {
+        acceptor_.assign(tcp::v4(), inherited.tcp);
+    }
+    else
+    {
+        const tcp::endpoint endpoint(tcp::v4(), port);
+        acceptor_.open(endpoint.protocol());
+        acceptor_.set_option(tcp::acceptor::reuse_address(true));
+        acceptor_.bind(endpoint);
+        acceptor_.listen();
+    }
+
+    if (inherited.local >= 0)
+    {
+        local_acceptor_.emplace(accept_strand_);
+        local_acceptor_->assign(stream_protocol(), inherited.local);
+    }
+    else if (!unix_socket_path_.empty())
+    {
+        // A socket file left behind by a previous run would make bind() fail.
+        std::error_code ignored;
+        if (std::filesystem::is_socket(unix_socket_path_, ignored))
+        {
+            std::filesystem::remove(unix_socket_path_, ignored);
+        }
+
+        local_acceptor_.emplace(accept_strand_, stream_protocol::endpoint(unix_socket_path_));
+    }
+}
+
+TcpServer::~TcpServer()
+{
+    if (local_acceptor_ && !handed_off_.load())
+    {
+        std::error_code ignored;
+        if (std::filesystem::is_socket(unix_socket_path_, ignored))
+        {
+            std::filesystem::remove(unix_socket_path_, ignored);
+        }
+    }
 }
 
 void TcpServer::run()
 {
-    ds::log::info("Server listening on port " + std::to_string(acceptor_.local_endpoint().port()));
+    ds::log::info("Server listening on port " + std::to_string(acceptor_.local_endpoint().port()) +
+                  " with " + std::to_string(worker_threads_) + " worker threads");
 
-    while (true)
+    do_accept();
+
+    if (local_acceptor_)
     {
-        tcp::socket socket(io_context_);
-        acceptor_.accept(socket);
+        ds::log::info("Server listening on unix socket " + unix_socket_path_);
+        do_accept_local();
+    }
 
-        ClientSession session(socket, detector_, expected_input_size_);
-        session.run();
+    if (idle_timer_)
+    {
+        do_idle_tick();
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(worker_threads_ - 1);
+    for (std::size_t i = 1; i < worker_threads_; ++i)
+    {
+        workers.emplace_back([this] { run_busy_polling(io_context_, busy_poll_); });
     }
+
+    run_busy_polling(io_context_, busy_poll_);
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void TcpServer::do_accept()
+{
+    // Each connection gets its own strand so its handlers never run concurrently,
+    // while different connections are spread across the worker threads.
+    acceptor_.async_accept(
+        boost::asio::make_strand(io_context_),
+        boost::asio::bind_executor(accept_strand_, [this](const boost::system::error_code &ec, tcp::socket socket) {
+            if (!acceptor_.is_open())
+            {
+                return;
+            }
+
+            if (ec)
+            {
+                ds::log::error("Accept failed: " + ec.message());
+            }
+            else
+            {
+                boost::system::error_code endpoint_ec;
+                const auto endpoint = socket.remote_endpoint(endpoint_ec);
+                std::string peer = endpoint_ec ? std::string("unknown") : endpoint.address().to_string();
+                enable_socket_busy_poll(socket.native_handle(), busy_poll_);
+
+                auto session = ClientSession::create(ClientSession::Socket(std::move(socket)),
+                                                     std::move(peer),
+                                                     detector_,
+                                                     scheduler_,
+                                                     expected_input_size_,
+                                                     idle_timer_ ? &*idle_timer_ : nullptr);
+                track(session);
+                session->start();
+            }
+
+            do_accept();
+        }));
+}
+
+void TcpServer::do_accept_local()
+{
+    local_acceptor_->async_accept(
+        boost::asio::make_strand(io_context_),
+        boost::asio::bind_executor(accept_strand_, [this](const boost::system::error_code &ec,
+                                                          stream_protocol::socket socket) {
+            if (!local_acceptor_->is_open())
+            {
+                return;
+            }
+
+            if (ec)
+            {
+                ds::log::error("Unix socket accept failed: " + ec.message());
+            }
+            else
+            {
+                auto session = ClientSession::create(ClientSession::Socket(std::move(socket)),
+                                                     "unix:" + unix_socket_path_,
+                                                     detector_,
+                                                     scheduler_,
+                                                     expected_input_size_,
+                                                     idle_timer_ ? &*idle_timer_ : nullptr);
+                track(session);
+                session->start();
+            }
+
+            do_accept_local();
+        }));
+}
+
+Listeners TcpServer::listeners()
+{
+    Listeners listeners;
+    listeners.tcp = acceptor_.native_handle();
+    if (local_acceptor_)
+    {
+        listeners.local = local_acceptor_->native_handle();
+    }
+    return listeners;
+}
+
+void TcpServer::drain(std::chrono::seconds deadline)
+{
+    handed_off_.store(true);
+    boost::asio::post(accept_strand_, [this, deadline] {
+        // The listening sockets stay open in the replacement that received them.
+        boost::system::error_code ignored;
+        acceptor_.close(ignored);
+        if (local_acceptor_)
+        {
+            local_acceptor_->close(ignored);
+        }
+        idle_tick_.cancel();
+
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex_);
+            for (const auto &entry : sessions_)
+            {
+                if (auto session = entry.lock())
+                {
+                    session->drain();
+                }
+            }
+        }
+
+        check_drained(std::chrono::steady_clock::now() + deadline);
+    });
+}
+
+void TcpServer::track(const std::shared_ptr<ClientSession> &session)
+{
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    if (sessions_.size() >= prune_at_)
+    {
+        sessions_.erase(std::remove_if(sessions_.begin(), sessions_.end(),
+                                       [](const std::weak_ptr<ClientSession> &entry) { return entry.expired(); }),
+                        sessions_.end());
+        prune_at_ = std::max(kMinSessionPrune, sessions_.size() * 2);
+    }
+    sessions_.push_back(session);
+}
+
+void TcpServer::check_drained(std::chrono::steady_clock::time_point deadline)
+{
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        sessions_.erase(std::remove_if(sessions_.begin(), sessions_.end(),
+                                       [](const std::weak_ptr<ClientSession> &entry) { return entry.expired(); }),
+                        sessions_.end());
+
+        // A session lives on until its last scheduler completion has run, so an
+        // empty list means nothing can touch the io_context any more.
+        if (sessions_.empty())
+        {
+            ds::log::info("All connections drained");
+            io_context_.stop();
+            return;
+        }
+
+        if (!sessions_stopped_ && std::chrono::steady_clock::now() >= deadline)
+        {
+            ds::log::info("Drain deadline passed; closing " + std::to_string(sessions_.size()) + " connections");
+            sessions_stopped_ = true;
+            for (const auto &entry : sessions_)
+            {
+                if (auto session = entry.lock())
+                {
+                    session->stop();
+                }
+            }
+        }
+    }
+
+    drain_timer_.expires_after(kDrainCheckInterval);
+    drain_timer_.async_wait([this, deadline](const boost::system::error_code &ec) {
+        if (!ec)
+        {
+            check_drained(deadline);
+        }
+    });
+}
+
+void TcpServer::do_idle_tick()
+{
+    idle_tick_.expires_after(idle_timer_->tick());
+    idle_tick_.async_wait([this](const boost::system::error_code &ec) {
+        if (ec)
+        {
+            return;
+        }
+
+        idle_timer_->advance(&ClientSession::expire_idle);
+        do_idle_tick();
+    });
 }
 } // namespace ds
@@ -4,6 +4,7 @@
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <utility>
@@ -154,6 +155,9 @@ public:
             throw std::runtime_error("Invalid input size for TensorRT backend");
         }
 
+        // One execution context, stream and device buffer pair is shared by every caller.
+        std::lock_guard<std::mutex> lock(mutex_);
+
         throw_if_cuda_failed(
             cudaMemcpyAsync(device_input_,
                             input.data(),
@@ -344,6 +348,7 @@ private:
     void *device_input_{nullptr};
     void *device_output_{nullptr};
     cudaStream_t stream_{nullptr};
+    std::mutex mutex_;
 };
 #else
 class TensorRtInferenceBackend::Impl
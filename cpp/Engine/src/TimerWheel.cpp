@@ -0,0 +1,93 @@
+#include "TimerWheel.hpp"
+
+#include <stdexcept>
+
+namespace ds
+{
+TimerWheel::TimerWheel(std::chrono::milliseconds timeout, std::chrono::milliseconds tick)
+    : tick_(tick)
+{
+    if (tick.count() <= 0 || timeout < tick)
+    {
+        throw std::runtime_error("Timer wheel timeout must be at least one positive tick");
+    }
+
+    timeout_ticks_ = static_cast<std::uint32_t>((timeout + tick - std::chrono::milliseconds(1)) / tick);
+
+    std::uint32_t slots = 1;
+    while (slots <= timeout_ticks_)
+    {
+        slots <<= 1;
+    }
+    slot_mask_ = slots - 1;
+
+    slots_ = std::vector<Entry>(slots);
+    for (Entry &head : slots_)
+    {
+        head.prev_ = &head;
+        head.next_ = &head;
+    }
+}
+
+void TimerWheel::add(Entry &entry)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::uint32_t now = current_tick_.load(std::memory_order_relaxed);
+    entry.last_active_.store(now, std::memory_order_relaxed);
+    link(slot_for(now + timeout_ticks_), entry);
+    ++size_;
+}
+
+void TimerWheel::remove(Entry &entry)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entry.next_ != nullptr)
+    {
+        unlink(entry);
+        --size_;
+    }
+}
+
+void TimerWheel::touch(Entry &entry)
+{
+    entry.last_active_.store(current_tick_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+bool TimerWheel::idle(const Entry &entry) const
+{
+    return current_tick_.load(std::memory_order_relaxed) - entry.last_active_.load(std::memory_order_relaxed) >=
+           timeout_ticks_;
+}
+
+std::chrono::milliseconds TimerWheel::tick() const
+{
+    return tick_;
+}
+
+std::size_t TimerWheel::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+void TimerWheel::link(Entry &head, Entry &entry)
+{
+    entry.prev_ = head.prev_;
+    entry.next_ = &head;
+    head.prev_->next_ = &entry;
+    head.prev_ = &entry;
+}
+
+void TimerWheel::unlink(Entry &entry)
+{
+    entry.prev_->next_ = entry.next_;
+    entry.next_->prev_ = entry.prev_;
+    entry.prev_ = nullptr;
+    entry.next_ = nullptr;
+}
+
+TimerWheel::Entry &TimerWheel::slot_for(std::uint32_t tick)
+{
+    return slots_[tick & slot_mask_];
+}
+} // namespace ds
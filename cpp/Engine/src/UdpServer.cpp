@@ -0,0 +1,247 @@
+#include "UdpServer.hpp"
+
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#include "InputParser.hpp"
+#include "Logger.hpp"
+#include "WireProtocol.hpp"
+
+namespace ds
+{
+namespace
+{
+// recvmmsg wakes up this often with nothing to do so shutdown is noticed.
+constexpr long kReceiveTimeoutMicroseconds = 100'000;
+
+std::string format_peer(const sockaddr_in &peer)
+{
+    char address[INET_ADDRSTRLEN] = {};
+    ::inet_ntop(AF_INET, &peer.sin_addr, address, sizeof(address));
+    return std::string(address) + ":" + std::to_string(ntohs(peer.sin_port));
+}
+} // namespace
+
+UdpServer::UdpServer(unsigned short port,
+                     AnomalyDetector &detector,
+                     std::size_t expected_input_size,
+                     IAnomalySink &sink)
+    : port_(port),
+      detector_(detector),
+      expected_input_size_(expected_input_size),
+      sink_(sink),
+      // One spare byte per datagram lets a final unterminated text line be closed.
+      buffers_(kBatchSize * (kMaxDatagramSize + 1))
+{
+    fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd_ < 0)
+    {
+        throw std::runtime_error(std::string("Failed to create UDP socket: ") + std::strerror(errno));
+    }
+
+    const timeval timeout{.tv_sec = 0, .tv_usec = kReceiveTimeoutMicroseconds};
+    ::setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port_);
+    if (::bind(fd_, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+    {
+        const std::string reason = std::strerror(errno);
+        ::close(fd_);
+        throw std::runtime_error("Failed to bind UDP port " + std::to_string(port_) + ": " + reason);
+    }
+
+    for (std::size_t i = 0; i < kBatchSize; ++i)
+    {
+        iovecs_[i].iov_base = buffers_.data() + i * (kMaxDatagramSize + 1);
+        iovecs_[i].iov_len = kMaxDatagramSize;
+    }
+}
+
+UdpServer::~UdpServer()
+{
+    stop_requested_.store(true);
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+
+    ::close(fd_);
+}
+
+void UdpServer::start()
+{
+    ds::log::info("UDP ingestion listening on port " + std::to_string(port_));
+    thread_ = std::thread([this] { run(); });
+}
+
+void UdpServer::run()
+{
+    while (!stop_requested_.load(std::memory_order_relaxed))
+    {
+        for (std::size_t i = 0; i < kBatchSize; ++i)
+        {
+            messages_[i].msg_hdr = msghdr{};
+            messages_[i].msg_hdr.msg_name = &peers_[i];
+            messages_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+            messages_[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        // Block for the first datagram, then take whatever else is already queued.
+        const int received = ::recvmmsg(fd_, messages_.data(), kBatchSize, MSG_WAITFORONE, nullptr);
+        if (received < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                ds::log::error(std::string("UDP receive failed: ") + std::strerror(errno));
+            }
+            continue;
+        }
+
+        row_origins_.clear();
+        for (std::uint32_t i = 0; i < static_cast<std::uint32_t>(received); ++i)
+        {
+            const mmsghdr &message = messages_[i];
+            char *data = static_cast<char *>(iovecs_[i].iov_base);
+            std::size_t length = message.msg_len;
+
+            if ((message.msg_hdr.msg_flags & MSG_TRUNC) != 0)
+            {
+                ds::log::error("Dropping oversized UDP datagram from " + format_peer(peers_[i]));
+                continue;
+            }
+
+            const std::string_view payload(data, length);
+            if (wire::match_binary_magic(payload) == wire::MagicMatch::Binary)
+            {
+                collect_binary_rows(i, payload.substr(wire::kBinaryMagic.size()));
+                continue;
+            }
+
+            // A datagram always ends its last line.
+            if (length > 0 && data[length - 1] != '\n')
+            {
+                data[length++] = '\n';
+            }
+            collect_text_rows(i, std::string_view(data, length));
+        }
+
+        if (!row_origins_.empty())
+        {
+            score_rows();
+        }
+    }
+}
+
+std::span<float> UdpServer::next_row()
+{
+    const std::size_t row = row_origins_.size();
+    if (batch_inputs_.size() < (row + 1) * expected_input_size_)
+    {
+        batch_inputs_.resize((row + 1) * expected_input_size_);
+    }
+
+    return std::span<float>(batch_inputs_).subspan(row * expected_input_size_, expected_input_size_);
+}
+
+void UdpServer::collect_text_rows(std::uint32_t datagram, std::string_view text)
+{
+    tokenize_lines(text, tokenized_);
+
+    for (const TextLine &line : tokenized_.lines)
+    {
+        if (line.token_count == 0)
+        {
+            continue;
+        }
+
+        const auto tokens = std::span<const TextToken>(tokenized_.tokens).subspan(line.first_token, line.token_count);
+        std::optional<std::uint64_t> request_id;
+        const ParseResult parsed = parse_request_line(text, tokens, next_row(), request_id);
+
+        if (parsed.status != ParseStatus::Ok || parsed.count != expected_input_size_)
+        {
+            ds::log::error("Dropping invalid UDP line from " + format_peer(peers_[datagram]));
+            continue;
+        }
+
+        row_origins_.push_back(RowOrigin{datagram, request_id});
+    }
+}
+
+void UdpServer::collect_binary_rows(std::uint32_t datagram, std::string_view payload)
+{
+    while (!payload.empty())
+    {
+        if (payload.size() < wire::kFrameHeaderSize)
+        {
+            ds::log::error("Dropping truncated UDP frame from " + format_peer(peers_[datagram]));
+            return;
+        }
+
+        const wire::FrameHeader header = wire::decode_frame_header(payload.data());
+        if (!header.valid() || header.batch() || payload.size() < wire::kFrameHeaderSize + header.payload_size())
+        {
+            ds::log::error("Dropping malformed UDP frame from " + format_peer(peers_[datagram]));
+            return;
+        }
+
+        const char *body = payload.data() + wire::kFrameHeaderSize;
+        payload.remove_prefix(wire::kFrameHeaderSize + header.payload_size());
+
+        std::optional<std::uint64_t> request_id;
+        if (header.tagged())
+        {
+            request_id = wire::decode_request_id(body);
+            body += wire::kRequestIdSize;
+        }
+
+        if (header.count != expected_input_size_)
+        {
+            ds::log::error("Dropping UDP frame with " + std::to_string(header.count) + " values from " +
+                           format_peer(peers_[datagram]));
+            continue;
+        }
+
+        wire::decode_frame_values(header, body, next_row());
+        row_origins_.push_back(RowOrigin{datagram, request_id});
+    }
+}
+
+void UdpServer::score_rows()
+{
+    const std::size_t rows = row_origins_.size();
+    batch_results_.resize(rows);
+
+    try
+    {
+        detector_.evaluate_batch(std::span<const float>(batch_inputs_.data(), rows * expected_input_size_),
+                                 std::span<DetectionResult>(batch_results_.data(), rows));
+    }
+    catch (const std::exception &ex)
+    {
+        ds::log::error(std::string("UDP batch inference failed: ") + ex.what());
+        return;
+    }
+
+    for (std::size_t row = 0; row < rows; ++row)
+    {
+        if (batch_results_[row].status == DetectionStatus::Anomaly)
+        {
+            const RowOrigin &origin = row_origins_[row];
+            sink_.report(AnomalyReport{.source = format_peer(peers_[origin.datagram]),
+                                       .request_id = origin.request_id,
+                                       .mse = batch_results_[row].mse});
+        }
+    }
+}
+} // namespace ds
@@ -0,0 +1,963 @@
+#include "UringServer.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "BusyPoll.hpp"
+#include "IoUring.hpp"
+#include "Logger.hpp"
+#include "ReplyBuffer.hpp"
+#include "RequestMetrics.hpp"
+#include "SessionProtocol.hpp"
+#include "SlabPool.hpp"
+#include "ThreadCount.hpp"
+#include "TimerWheel.hpp"
+
+namespace ds
+{
+namespace
+{
+constexpr unsigned kRingEntries = 1024;
+constexpr std::uint16_t kReceiveBufferGroup = 0;
+constexpr std::uint16_t kReceiveBufferCount = 256;
+constexpr std::size_t kReceiveBufferSize = 16 * 1024;
+// Past this many unsent reply bytes a connection stops reading until its write
+// completes, so a client that never reads its replies cannot grow them without bound.
+constexpr std::size_t kMaxQueuedReplyBytes = 1024 * 1024;
+// Upper bound on reply chunks handed to one send; more wait for the next one.
+constexpr std::size_t kMaxSendSegments = 64;
+// How often a draining worker closes the connections that reached a request boundary
+// and checks its deadline.
+constexpr std::chrono::milliseconds kDrainCheckInterval{10};
+
+// Completion user_data: a Connection pointer or listener index with the operation
+// kind in the low bits.
+enum class Operation : std::uint64_t
+{
+    Accept = 1,
+    Receive = 2,
+    Send = 3,
+    Wake = 4,
+    Cancel = 5,
+    Tick = 6,
+    Drain = 7
+};
+constexpr std::uint64_t kOperationMask = 0x7;
+
+struct Connection;
+using ConnectionDispatch = std::function<void(Connection &, std::uint64_t, std::vector<float>)>;
+
+struct Connection : TimerWheel::Entry
+{
+    Connection(int socket_fd,
+               std::string peer_name,
+               AnomalyDetector &detector,
+               std::size_t expected_input_size,
+               const ConnectionDispatch &dispatch,
+               InferenceScheduler &scheduler)
+        : fd(socket_fd),
+          peer(std::move(peer_name)),
+          protocol(detector,
+                   expected_input_size,
+                   // The worker's dispatch outlives its connections; a reference keeps
+                   // the callback small enough to need no allocation of its own.
+                   [this, &dispatch](std::uint64_t request_id, std::vector<float> values) {
+                       dispatch(*this, request_id, std::move(values));
+                   },
+                   [&scheduler](std::size_t in_flight) { return scheduler.admits(in_flight); })
+    {
+        count_connection_opened();
+    }
+
+    ~Connection()
+    {
+        count_connection_closed();
+    }
+
+    Connection(const Connection &) = delete;
+    Connection &operator=(const Connection &) = delete;
+
+    int fd;
+    std::string peer;
+    SessionProtocol protocol;
+    // Bytes of an incomplete request carried over to the next receive.
+    SlabString pending;
+    // Replies keep collecting while earlier ones are on the wire; each send gathers
+    // every queued chunk.
+    ReplyBuffer replies;
+    SlabVector<iovec> send_segments;
+    msghdr send_message{};
+    unsigned operations_in_flight{0};
+    ThrottleTimer throttle;
+    bool writing{false};
+    bool receive_armed{false};
+    bool read_paused{false};
+    bool read_closed{false};
+    bool closed{false};
+};
+
+struct TaggedCompletion
+{
+    Connection *connection;
+    std::uint64_t request_id;
+    std::exception_ptr error;
+    DetectionResult result;
+};
+
+std::uint64_t user_data(const void *target, Operation operation)
+{
+    return reinterpret_cast<std::uint64_t>(target) | static_cast<std::uint64_t>(operation);
+}
+
+std::string format_peer(int fd)
+{
+    sockaddr_in address{};
+    socklen_t length = sizeof(address);
+    char text[INET_ADDRSTRLEN] = {};
+    if (::getpeername(fd, reinterpret_cast<sockaddr *>(&address), &length) != 0 || address.sin_family != AF_INET ||
+        ::inet_ntop(AF_INET, &address.sin_addr, text, sizeof(text)) == nullptr)
+    {
+        return "unknown";
+    }
+
+    return text;
+}
+
+int open_tcp_listener(std::uint16_t port)
+{
+    const int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        throw std::runtime_error(std::string("Failed to create listening socket: ") + std::strerror(errno));
+    }
+
+    const int enable = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (::bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(fd, SOMAXCONN) != 0)
+    {
+        const std::string reason = std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("Failed to listen on port " + std::to_string(port) + ": " + reason);
+    }
+
+    return fd;
+}
+
+int open_local_listener(const std::string &path)
+{
+    // A socket file left behind by a previous run would make bind() fail.
+    std::error_code ignored;
+    if (std::filesystem::is_socket(path, ignored))
+    {
+        std::filesystem::remove(path, ignored);
+    }
+
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("Unix socket path is too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(fd, SOMAXCONN) != 0)
+    {
+        const std::string reason = std::strerror(errno);
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+        throw std::runtime_error("Failed to listen on unix socket " + path + ": " + reason);
+    }
+
+    return fd;
+}
+
+// One ring and the connections it accepted. Everything except the completion queue
+// fed by inference workers is touched only by the owning thread.
+class Worker
+{
+public:
+    Worker(std::span<const int> listeners,
+           const std::string &unix_socket_path,
+           AnomalyDetector &detector,
+           InferenceScheduler &scheduler,
+           std::size_t expected_input_size,
+           std::chrono::microseconds busy_poll,
+           std::chrono::seconds idle_timeout,
+           int drain_fd,
+           const std::atomic<std::int64_t> &drain_seconds)
+        : listeners_(listeners.begin(), listeners.end()),
+          unix_socket_path_(unix_socket_path),
+          detector_(detector),
+          scheduler_(scheduler),
+          expected_input_size_(expected_input_size),
+          busy_poll_(busy_poll),
+          ring_(kRingEntries),
+          buffers_(ring_, kReceiveBufferGroup, kReceiveBufferCount, kReceiveBufferSize),
+          wake_fd_(::eventfd(0, EFD_CLOEXEC)),
+          drain_fd_(drain_fd),
+          drain_seconds_(drain_seconds),
+          dispatch_([this](Connection &connection, std::uint64_t request_id, std::vector<float> values) {
+              dispatch_tagged(connection, request_id, std::move(values));
+          })
+    {
+        if (wake_fd_ < 0)
+        {
+            throw std::runtime_error(std::string("Failed to create eventfd: ") + std::strerror(errno));
+        }
+
+        if (idle_timeout.count() > 0)
+        {
+            idle_timer_.emplace(idle_timeout);
+            const auto tick = std::chrono::duration_cast<std::chrono::nanoseconds>(idle_timer_->tick());
+            tick_interval_.tv_sec = tick.count() / 1'000'000'000;
+            tick_interval_.tv_nsec = tick.count() % 1'000'000'000;
+        }
+
+        const auto check = std::chrono::duration_cast<std::chrono::nanoseconds>(kDrainCheckInterval);
+        drain_check_interval_.tv_sec = check.count() / 1'000'000'000;
+        drain_check_interval_.tv_nsec = check.count() % 1'000'000'000;
+    }
+
+    ~Worker()
+    {
+        ::close(wake_fd_);
+    }
+
+    Worker(const Worker &) = delete;
+    Worker &operator=(const Worker &) = delete;
+
+    void run()
+    {
+        for (std::size_t i = 0; i < listeners_.size(); ++i)
+        {
+            arm_accept(i);
+        }
+        arm_wake();
+        arm_drain_poll();
+        if (idle_timer_)
+        {
+            arm_tick();
+        }
+
+        // With busy polling, keep entering the ring without waiting until nothing has
+        // completed for busy_poll_, then block for the next completion. A draining
+        // worker returns once its last connection is released.
+        auto last_activity = std::chrono::steady_clock::now();
+        bool spinning = false;
+        while (!draining_ || !connections_.empty())
+        {
+            ring_.submit_and_wait(spinning ? 0 : 1);
+            const unsigned handled = ring_.drain_completions([this](const io_uring_cqe &cqe) { handle(cqe); });
+
+            const auto now = std::chrono::steady_clock::now();
+            if (handled > 0)
+            {
+                last_activity = now;
+            }
+            spinning = now - last_activity < busy_poll_;
+        }
+    }
+
+private:
+    void handle(const io_uring_cqe &cqe)
+    {
+        const auto operation = static_cast<Operation>(cqe.user_data & kOperationMask);
+        const std::uint64_t target = cqe.user_data & ~kOperationMask;
+
+        switch (operation)
+        {
+        case Operation::Accept:
+            on_accept(static_cast<std::size_t>(target >> 3), cqe);
+            break;
+        case Operation::Receive:
+            on_receive(*reinterpret_cast<Connection *>(target), cqe);
+            break;
+        case Operation::Send:
+            on_send(*reinterpret_cast<Connection *>(target), cqe);
+            break;
+        case Operation::Wake:
+            on_wake();
+            break;
+        case Operation::Cancel:
+            break;
+        case Operation::Tick:
+            on_tick();
+            break;
+        case Operation::Drain:
+            on_drain();
+            break;
+        }
+    }
+
+    void arm_accept(std::size_t listener)
+    {
+        io_uring_sqe &sqe = ring_.next_sqe();
+        sqe.opcode = IORING_OP_ACCEPT;
+        sqe.fd = listeners_[listener];
+        sqe.ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe.accept_flags = SOCK_CLOEXEC;
+        sqe.user_data = (static_cast<std::uint64_t>(listener) << 3) | static_cast<std::uint64_t>(Operation::Accept);
+    }
+
+    void arm_wake()
+    {
+        io_uring_sqe &sqe = ring_.next_sqe();
+        sqe.opcode = IORING_OP_READ;
+        sqe.fd = wake_fd_;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&wake_value_);
+        sqe.len = sizeof(wake_value_);
+        sqe.user_data = static_cast<std::uint64_t>(Operation::Wake);
+    }
+
+    // Every worker polls the shared eventfd, so one write wakes them all.
+    void arm_drain_poll()
+    {
+        io_uring_sqe &sqe = ring_.next_sqe();
+        sqe.opcode = IORING_OP_POLL_ADD;
+        sqe.fd = drain_fd_;
+        sqe.poll32_events = POLLIN;
+        sqe.user_data = static_cast<std::uint64_t>(Operation::Drain);
+    }
+
+    void arm_drain_check()
+    {
+        io_uring_sqe &sqe = ring_.next_sqe();
+        sqe.opcode = IORING_OP_TIMEOUT;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&drain_check_interval_);
+        sqe.len = 1;
+        sqe.user_data = static_cast<std::uint64_t>(Operation::Drain);
+    }
+
+    void arm_tick()
+    {
+        io_uring_sqe &sqe = ring_.next_sqe();
+        sqe.opcode = IORING_OP_TIMEOUT;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&tick_interval_);
+        sqe.len = 1;
+        sqe.user_data = static_cast<std::uint64_t>(Operation::Tick);
+    }
+
+    void arm_receive(Connection &connection)
+    {
+        io_uring_sqe &sqe = ring_.next_sqe();
+        sqe.opcode = IORING_OP_RECV;
+        sqe.fd = connection.fd;
+        sqe.ioprio = IORING_RECV_MULTISHOT;
+        sqe.flags = IOSQE_BUFFER_SELECT;
+        sqe.buf_group = buffers_.group_id();
+        sqe.user_data = user_data(&connection, Operation::Receive);
+
+        connection.receive_armed = true;
+        ++connection.operations_in_flight;
+    }
+
+    void submit_send(Connection &connection)
+    {
+        connection.send_segments.clear();
+        connection.replies.gather(connection.send_segments, kMaxSendSegments);
+        connection.send_message = msghdr{};
+        connection.send_message.msg_iov = connection.send_segments.data();
+        connection.send_message.msg_iovlen = connection.send_segments.size();
+
+        io_uring_sqe &sqe = ring_.next_sqe();
+        sqe.opcode = IORING_OP_SENDMSG;
+        sqe.fd = connection.fd;
+        sqe.addr = reinterpret_cast<std::uint64_t>(&connection.send_message);
+        sqe.len = 1;
+        sqe.msg_flags = MSG_NOSIGNAL;
+        sqe.user_data = user_data(&connection, Operation::Send);
+
+        ++connection.operations_in_flight;
+    }
+
+    void cancel_receive(Connection &connection)
+    {
+        io_uring_sqe &sqe = ring_.next_sqe();
+        sqe.opcode = IORING_OP_ASYNC_CANCEL;
+        sqe.addr = user_data(&connection, Operation::Receive);
+        sqe.user_data = static_cast<std::uint64_t>(Operation::Cancel);
+    }
+
+    void on_accept(std::size_t listener, const io_uring_cqe &cqe)
+    {
+        if ((cqe.flags & IORING_CQE_F_MORE) == 0 && !draining_)
+        {
+            arm_accept(listener);
+        }
+
+        if (cqe.res < 0)
+        {
+            if (!draining_)
+            {
+                ds::log::error(std::string("Accept failed: ") + std::strerror(-cqe.res));
+            }
+            return;
+        }
+
+        if (draining_)
+        {
+            // Accepted just before the accept was cancelled; the client reconnects to
+            // the engine that now owns the listener.
+            ::close(cqe.res);
+            return;
+        }
+
+        const bool local = !unix_socket_path_.empty() && listener + 1 == listeners_.size();
+        std::string peer = local ? "unix:" + unix_socket_path_ : format_peer(cqe.res);
+        if (!local)
+        {
+            enable_socket_busy_poll(cqe.res, busy_poll_);
+        }
+
+        auto connection =
+            make_slab<Connection>(cqe.res, std::move(peer), detector_, expected_input_size_, dispatch_, scheduler_);
+        Connection &accepted = *connection;
+        connections_.emplace(&accepted, std::move(connection));
+        if (idle_timer_)
+        {
+            idle_timer_->add(accepted);
+        }
+
+        ds::log::info("Client connected: " + accepted.peer);
+        arm_receive(accepted);
+    }
+
+    void on_receive(Connection &connection, const io_uring_cqe &cqe)
+    {
+        if ((cqe.flags & IORING_CQE_F_MORE) == 0)
+        {
+            connection.receive_armed = false;
+            --connection.operations_in_flight;
+        }
+
+        if (cqe.res > 0)
+        {
+            const auto buffer_id = static_cast<std::uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            if (!connection.closed)
+            {
+                if (idle_timer_)
+                {
+                    idle_timer_->touch(connection);
+                }
+                const std::span<char> data = buffers_.buffer(buffer_id, static_cast<std::size_t>(cqe.res));
+                on_input(connection, std::string_view(data.data(), data.size()));
+            }
+            buffers_.recycle(buffer_id);
+        }
+        else if (cqe.res == 0)
+        {
+            // Let tagged requests that are still running deliver their replies first.
+            connection.read_closed = true;
+            close_when_drained(connection);
+        }
+        else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED && !connection.closed)
+        {
+            ds::log::error(std::string("Receive failed: ") + std::strerror(-cqe.res));
+            close(connection);
+        }
+
+        // A multishot receive also ends when the buffer group briefly runs dry.
+        if (!connection.receive_armed && !connection.closed && !reading_done(connection) && !connection.read_paused)
+        {
+            arm_receive(connection);
+        }
+
+        release_if_idle(connection);
+    }
+
+    void on_input(Connection &connection, std::string_view data)
+    {
+        try
+        {
+            if (connection.pending.empty())
+            {
+                // Common case: whole requests straight out of the kernel buffer.
+                const std::size_t consumed = connection.protocol.consume(data, connection.replies);
+                connection.pending.assign(data.substr(consumed));
+            }
+            else
+            {
+                connection.pending.append(data);
+                const std::size_t consumed = connection.protocol.consume(connection.pending, connection.replies);
+                connection.pending.erase(0, consumed);
+                if (connection.pending.empty())
+                {
+                    connection.pending.shrink_to_fit();
+                }
+            }
+        }
+        catch (const std::exception &ex)
+        {
+            ds::log::error(ex.what());
+            close(connection);
+            return;
+        }
+
+        flush(connection);
+        update_read_pause(connection);
+
+        if (draining_ && reading_done(connection) && connection.receive_armed && !connection.closed)
+        {
+            cancel_receive(connection);
+        }
+    }
+
+    // Stops the multishot receive while unsent replies pile up or the scheduler refuses
+    // more tagged requests from this connection, and re-arms it once neither holds.
+    void update_read_pause(Connection &connection)
+    {
+        const bool backlog = connection.writing && connection.replies.size() > kMaxQueuedReplyBytes;
+        const bool throttled = !scheduler_.admits(connection.protocol.tagged_in_flight());
+        if (throttled)
+        {
+            connection.throttle.begin();
+        }
+        else
+        {
+            connection.throttle.end();
+            if (connection.protocol.stalled() && !connection.closed)
+            {
+                // Requests held back at the limit go before anything new is read;
+                // on_input() comes back here once they are dispatched.
+                on_input(connection, {});
+                return;
+            }
+        }
+
+        const bool pause = backlog || throttled;
+        if (pause == connection.read_paused)
+        {
+            return;
+        }
+
+        connection.read_paused = pause;
+        if (pause)
+        {
+            if (connection.receive_armed)
+            {
+                cancel_receive(connection);
+            }
+        }
+        else if (!connection.receive_armed && !connection.closed && !reading_done(connection))
+        {
+            arm_receive(connection);
+        }
+    }
+
+    void on_send(Connection &connection, const io_uring_cqe &cqe)
+    {
+        --connection.operations_in_flight;
+
+        if (cqe.res < 0)
+        {
+            connection.writing = false;
+            if (!connection.closed)
+            {
+                ds::log::error(std::string("Send failed: ") + std::strerror(-cqe.res));
+                close(connection);
+            }
+            release_if_idle(connection);
+            return;
+        }
+
+        // A short send leaves the rest queued; the flush below picks it up.
+        connection.replies.consume(static_cast<std::size_t>(cqe.res));
+        connection.writing = false;
+        update_read_pause(connection);
+
+        flush(connection);
+        close_when_drained(connection);
+        release_if_idle(connection);
+    }
+
+    void flush(Connection &connection)
+    {
+        if (connection.writing || connection.replies.empty() || connection.closed)
+        {
+            return;
+        }
+
+        // Everything queued since the last send goes out in a single gather send.
+        connection.writing = true;
+        submit_send(connection);
+    }
+
+    void dispatch_tagged(Connection &connection, std::uint64_t request_id, std::vector<float> values)
+    {
+        Connection *target = &connection;
+        scheduler_.submit(std::move(values),
+                          [this, target, request_id](std::exception_ptr error, const DetectionResult &result) {
+                              post_completion(TaggedCompletion{target, request_id, error, result});
+                          });
+    }
+
+    // Runs on inference worker threads.
+    void post_completion(TaggedCompletion completion)
+    {
+        bool first = false;
+        {
+            std::lock_guard<std::mutex> lock(completions_mutex_);
+            first = completions_.empty();
+            completions_.push_back(std::move(completion));
+        }
+
+        if (first)
+        {
+            const std::uint64_t one = 1;
+            [[maybe_unused]] const ssize_t written = ::write(wake_fd_, &one, sizeof(one));
+        }
+    }
+
+    void on_wake()
+    {
+        arm_wake();
+
+        {
+            std::lock_guard<std::mutex> lock(completions_mutex_);
+            ready_completions_.swap(completions_);
+        }
+
+        for (const TaggedCompletion &completion : ready_completions_)
+        {
+            Connection &connection = *completion.connection;
+            if (connection.closed)
+            {
+                ReplyBuffer discarded;
+                connection.protocol.complete_tagged(completion.request_id, completion.error, completion.result,
+                                                    discarded);
+            }
+            else
+            {
+                connection.protocol.complete_tagged(completion.request_id, completion.error, completion.result,
+                                                    connection.replies);
+                flush(connection);
+                update_read_pause(connection);
+                close_when_drained(connection);
+            }
+            release_if_idle(connection);
+        }
+        ready_completions_.clear();
+    }
+
+    void on_tick()
+    {
+        arm_tick();
+
+        idle_timer_->advance(
+            [this](TimerWheel::Entry &entry) { expired_.push_back(&static_cast<Connection &>(entry)); });
+
+        for (Connection *connection : expired_)
+        {
+            // Quiet while requests are running or replies are still going out is not idle.
+            if (connection->protocol.tagged_in_flight() > 0 || connection->writing)
+            {
+                idle_timer_->add(*connection);
+                continue;
+            }
+
+            ds::log::info("Closing idle connection: " + connection->peer);
+            close(*connection);
+            release_if_idle(*connection);
+        }
+        expired_.clear();
+    }
+
+    // The first completion starts the drain: stop accepting, stop reading at each
+    // connection's next request boundary, and close once its replies are out. Later
+    // ones are periodic checks that close whatever is left after the deadline.
+    void on_drain()
+    {
+        const bool starting = !draining_;
+        if (starting)
+        {
+            draining_ = true;
+            drain_deadline_ = std::chrono::steady_clock::now() + std::chrono::seconds(drain_seconds_.load());
+            for (std::size_t i = 0; i < listeners_.size(); ++i)
+            {
+                io_uring_sqe &sqe = ring_.next_sqe();
+                sqe.opcode = IORING_OP_ASYNC_CANCEL;
+                sqe.addr = (static_cast<std::uint64_t>(i) << 3) | static_cast<std::uint64_t>(Operation::Accept);
+                sqe.user_data = static_cast<std::uint64_t>(Operation::Cancel);
+            }
+        }
+
+        const bool overdue = std::chrono::steady_clock::now() >= drain_deadline_;
+        if (overdue && !connections_.empty())
+        {
+            ds::log::info("Drain deadline passed; closing " + std::to_string(connections_.size()) + " connections");
+        }
+
+        for (const auto &entry : connections_)
+        {
+            expired_.push_back(entry.first);
+        }
+        for (Connection *connection : expired_)
+        {
+            if (overdue)
+            {
+                close(*connection);
+            }
+            else if (!connection->closed)
+            {
+                if (!reading_done(*connection))
+                {
+                    // Bytes that arrived after the receive was cancelled.
+                    if (!connection->receive_armed && !connection->read_paused)
+                    {
+                        arm_receive(*connection);
+                    }
+                }
+                else if (connection->receive_armed)
+                {
+                    cancel_receive(*connection);
+                }
+                else if (!starting)
+                {
+                    // Not on the first pass: receives completed in this batch may
+                    // still be waiting in the completion queue.
+                    close_when_drained(*connection);
+                }
+            }
+            release_if_idle(*connection);
+        }
+        expired_.clear();
+
+        arm_drain_check();
+    }
+
+    bool reading_done(const Connection &connection) const
+    {
+        return connection.read_closed || (draining_ && at_request_boundary(connection));
+    }
+
+    // Requests the client already sent count too, even while still in the kernel.
+    static bool at_request_boundary(const Connection &connection)
+    {
+        int unread = 0;
+        return connection.pending.empty() && !connection.protocol.stalled() &&
+               ::ioctl(connection.fd, FIONREAD, &unread) == 0 && unread == 0;
+    }
+
+    void close_when_drained(Connection &connection)
+    {
+        if (reading_done(connection) && connection.protocol.tagged_in_flight() == 0 && !connection.writing &&
+            connection.replies.empty())
+        {
+            close(connection);
+        }
+    }
+
+    void close(Connection &connection)
+    {
+        if (connection.closed)
+        {
+            return;
+        }
+        connection.closed = true;
+        connection.throttle.end();
+        if (idle_timer_)
+        {
+            idle_timer_->remove(connection);
+        }
+
+        // Ends the multishot receive and any pending send; the descriptor itself is
+        // closed once the ring no longer references the connection.
+        ::shutdown(connection.fd, SHUT_RDWR);
+        ds::log::info("Client disconnected");
+    }
+
+    void release_if_idle(Connection &connection)
+    {
+        if (connection.closed && connection.operations_in_flight == 0 && connection.protocol.tagged_in_flight() == 0)
+        {
+            ::close(connection.fd);
+            connections_.erase(&connection);
+        }
+    }
+
+    std::vector<int> listeners_;
+    std::string unix_socket_path_;
+    AnomalyDetector &detector_;
+    InferenceScheduler &scheduler_;
+    std::size_t expected_input_size_;
+    std::chrono::microseconds busy_poll_;
+    uring::Ring ring_;
+    uring::BufferRing buffers_;
+    int wake_fd_;
+    std::uint64_t wake_value_{0};
+    int drain_fd_;
+    const std::atomic<std::int64_t> &drain_seconds_;
+    __kernel_timespec drain_check_interval_{};
+    std::chrono::steady_clock::time_point drain_deadline_;
+    bool draining_{false};
+    ConnectionDispatch dispatch_;
+    std::unordered_map<Connection *,
+                       SlabPtr<Connection>,
+                       std::hash<Connection *>,
+                       std::equal_to<Connection *>,
+                       SlabAllocator<std::pair<Connection *const, SlabPtr<Connection>>>>
+        connections_;
+    std::optional<TimerWheel> idle_timer_;
+    __kernel_timespec tick_interval_{};
+    std::vector<Connection *> expired_;
+
+    std::mutex completions_mutex_;
+    std::vector<TaggedCompletion> completions_;
+    std::vector<TaggedCompletion> ready_completions_;
+};
+} // namespace
+
+UringServer::UringServer(std::uint16_t port,
+                         AnomalyDetector &detector,
+                         InferenceScheduler &scheduler,
+                         std::size_t expected_input_size,
+                         std::size_t worker_threads,
+                         const std::string &unix_socket_path,
+                         std::chrono::microseconds busy_poll,
+                         std::chrono::seconds idle_timeout,
+                         Listeners inherited)
+    : port_(port),
+      unix_socket_path_(unix_socket_path),
+      detector_(detector),
+      scheduler_(scheduler),
+      expected_input_size_(expected_input_size),
+      worker_threads_(resolve_thread_count(worker_threads)),
+      busy_poll_(busy_poll),
+      idle_timeout_(idle_timeout)
+{
+    drain_fd_ = ::eventfd(0, EFD_CLOEXEC);
+    if (drain_fd_ < 0)
+    {
+        throw std::runtime_error(std::string("Failed to create eventfd: ") + std::strerror(errno));
+    }
+
+    try
+    {
+        listen_fd_ = inherited.tcp >= 0 ? inherited.tcp : open_tcp_listener(port_);
+        if (inherited.local >= 0)
+        {
+            local_listen_fd_ = inherited.local;
+        }
+        else if (!unix_socket_path_.empty())
+        {
+            local_listen_fd_ = open_local_listener(unix_socket_path_);
+        }
+    }
+    catch (...)
+    {
+        if (listen_fd_ >= 0)
+        {
+            ::close(listen_fd_);
+        }
+        ::close(drain_fd_);
+        throw;
+    }
+}
+
+UringServer::~UringServer()
+{
+    ::close(listen_fd_);
+    if (local_listen_fd_ >= 0)
+    {
+        ::close(local_listen_fd_);
+
+        std::error_code ignored;
+        if (!handed_off_.load() && std::filesystem::is_socket(unix_socket_path_, ignored))
+        {
+            std::filesystem::remove(unix_socket_path_, ignored);
+        }
+    }
+    ::close(drain_fd_);
+}
+
+bool UringServer::supported()
+{
+    return uring::kernel_supports_multishot();
+}
+
+Listeners UringServer::listeners() const
+{
+    return Listeners{listen_fd_, local_listen_fd_};
+}
+
+void UringServer::drain(std::chrono::seconds deadline)
+{
+    handed_off_.store(true);
+    drain_seconds_.store(deadline.count());
+    const std::uint64_t one = 1;
+    [[maybe_unused]] const ssize_t written = ::write(drain_fd_, &one, sizeof(one));
+}
+
+void UringServer::run()
+{
+    ds::log::info("Server listening on port " + std::to_string(port_) + " with " + std::to_string(worker_threads_) +
+                  " io_uring workers");
+    if (local_listen_fd_ >= 0)
+    {
+        ds::log::info("Server listening on unix socket " + unix_socket_path_);
+    }
+
+    std::vector<int> listeners{listen_fd_};
+    if (local_listen_fd_ >= 0)
+    {
+        listeners.push_back(local_listen_fd_);
+    }
+
+    // Every worker arms its own multishot accept on the shared listeners, and each
+    // ring is created on the thread that drives it.
+    const auto serve = [this, &listeners] {
+        Worker worker(listeners, unix_socket_path_, detector_, scheduler_, expected_input_size_, busy_poll_,
+                      idle_timeout_, drain_fd_, drain_seconds_);
+        worker.run();
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(worker_threads_ - 1);
+    for (std::size_t i = 1; i < worker_threads_; ++i)
+    {
+        workers.emplace_back(serve);
+    }
+
+    serve();
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+
+    ds::log::info("All connections drained");
+}
+} // namespace ds
@@ -0,0 +1,404 @@
+#include "WireProtocol.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <vector>
+
+#include "Lz4Block.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DS_WIRE_X86 1
+#else
+#define DS_WIRE_X86 0
+#endif
+
+namespace ds::wire
+{
+namespace
+{
+template <typename T>
+T load_le(const char *data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big)
+    {
+        auto bytes = std::bit_cast<std::array<unsigned char, sizeof(T)>>(value);
+        std::reverse(bytes.begin(), bytes.end());
+        value = std::bit_cast<T>(bytes);
+    }
+    return value;
+}
+
+template <typename T>
+void store_le(char *out, T value)
+{
+    if constexpr (std::endian::native == std::endian::big)
+    {
+        auto bytes = std::bit_cast<std::array<unsigned char, sizeof(T)>>(value);
+        std::reverse(bytes.begin(), bytes.end());
+        value = std::bit_cast<T>(bytes);
+    }
+    std::memcpy(out, &value, sizeof(T));
+}
+
+float half_to_float(std::uint16_t half)
+{
+    const std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000u) << 16;
+    const std::uint32_t exponent = (half >> 10) & 0x1fu;
+    const std::uint32_t mantissa = half & 0x3ffu;
+
+    if (exponent == 0)
+    {
+        // Zero or subnormal: mantissa * 2^-24.
+        const float magnitude = static_cast<float>(mantissa) * 0x1p-24f;
+        return (sign != 0) ? -magnitude : magnitude;
+    }
+
+    if (exponent == 0x1fu)
+    {
+        // Infinity, or a NaN that comes out quiet like F16C's conversion makes it.
+        const std::uint32_t quiet = (mantissa != 0) ? 0x400000u : 0;
+        return std::bit_cast<float>(sign | 0x7f800000u | quiet | (mantissa << 13));
+    }
+
+    return std::bit_cast<float>(sign | ((exponent + (127 - 15)) << 23) | (mantissa << 13));
+}
+
+void decode_float16_scalar(const char *data, std::span<float> output)
+{
+    for (std::size_t i = 0; i < output.size(); ++i)
+    {
+        output[i] = half_to_float(load_le<std::uint16_t>(data + i * sizeof(std::uint16_t)));
+    }
+}
+
+void decode_int16_scalar(const char *data, float scale, std::span<float> output)
+{
+    for (std::size_t i = 0; i < output.size(); ++i)
+    {
+        output[i] = static_cast<float>(load_le<std::int16_t>(data + i * sizeof(std::int16_t))) * scale;
+    }
+}
+
+void decode_int8_scalar(const char *data, float scale, std::span<float> output)
+{
+    for (std::size_t i = 0; i < output.size(); ++i)
+    {
+        output[i] = static_cast<float>(static_cast<std::int8_t>(data[i])) * scale;
+    }
+}
+
+#if DS_WIRE_X86
+// Each kernel converts eight values per step and leaves the tail to the scalar loop.
+__attribute__((target("avx,f16c"))) void decode_float16_f16c(const char *data, std::span<float> output)
+{
+    const std::size_t vector_end = output.size() & ~std::size_t{7};
+    for (std::size_t i = 0; i < vector_end; i += 8)
+    {
+        const __m128i halves = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 2));
+        _mm256_storeu_ps(output.data() + i, _mm256_cvtph_ps(halves));
+    }
+    decode_float16_scalar(data + vector_end * 2, output.subspan(vector_end));
+}
+
+__attribute__((target("avx2"))) void decode_int16_avx2(const char *data, float scale, std::span<float> output)
+{
+    const __m256 factor = _mm256_set1_ps(scale);
+    const std::size_t vector_end = output.size() & ~std::size_t{7};
+    for (std::size_t i = 0; i < vector_end; i += 8)
+    {
+        const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i * 2));
+        const __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(packed));
+        _mm256_storeu_ps(output.data() + i, _mm256_mul_ps(values, factor));
+    }
+    decode_int16_scalar(data + vector_end * 2, scale, output.subspan(vector_end));
+}
+
+__attribute__((target("avx2"))) void decode_int8_avx2(const char *data, float scale, std::span<float> output)
+{
+    const __m256 factor = _mm256_set1_ps(scale);
+    const std::size_t vector_end = output.size() & ~std::size_t{7};
+    for (std::size_t i = 0; i < vector_end; i += 8)
+    {
+        const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(data + i));
+        const __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(packed));
+        _mm256_storeu_ps(output.data() + i, _mm256_mul_ps(values, factor));
+    }
+    decode_int8_scalar(data + vector_end, scale, output.subspan(vector_end));
+}
+#endif
+
+struct Decoders
+{
+    void (*float16)(const char *data, std::span<float> output);
+    void (*int16)(const char *data, float scale, std::span<float> output);
+    void (*int8)(const char *data, float scale, std::span<float> output);
+};
+
+Decoders select_decoders()
+{
+    Decoders decoders{decode_float16_scalar, decode_int16_scalar, decode_int8_scalar};
+#if DS_WIRE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("f16c"))
+    {
+        decoders.float16 = decode_float16_f16c;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        decoders.int16 = decode_int16_avx2;
+        decoders.int8 = decode_int8_avx2;
+    }
+#endif
+    return decoders;
+}
+
+const Decoders &decoders()
+{
+    static const Decoders selected = select_decoders();
+    return selected;
+}
+
+bool find_decoders(std::string_view isa_name, Decoders &found)
+{
+    found = Decoders{decode_float16_scalar, decode_int16_scalar, decode_int8_scalar};
+    if (isa_name == "scalar")
+    {
+        return true;
+    }
+#if DS_WIRE_X86
+    __builtin_cpu_init();
+    if (isa_name == "f16c" && __builtin_cpu_supports("f16c"))
+    {
+        found.float16 = decode_float16_f16c;
+        return true;
+    }
+    if (isa_name == "avx2" && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c"))
+    {
+        found = Decoders{decode_float16_f16c, decode_int16_avx2, decode_int8_avx2};
+        return true;
+    }
+#endif
+    return false;
+}
+
+void decode_with(const Decoders &selected, Encoding encoding, const char *data, float scale, std::span<float> output)
+{
+    switch (encoding)
+    {
+    case Encoding::Float32:
+        if constexpr (std::endian::native == std::endian::little)
+        {
+            std::memcpy(output.data(), data, output.size_bytes());
+        }
+        else
+        {
+            for (std::size_t i = 0; i < output.size(); ++i)
+            {
+                output[i] = load_le<float>(data + i * sizeof(float));
+            }
+        }
+        return;
+    case Encoding::Float16:
+        selected.float16(data, output);
+        return;
+    case Encoding::Int16:
+        selected.int16(data, scale, output);
+        return;
+    case Encoding::Int8:
+        selected.int8(data, scale, output);
+        return;
+    }
+}
+} // namespace
+
+bool FrameHeader::valid() const
+{
+    if (encoded_value_size(encoding) == 0)
+    {
+        return false;
+    }
+
+    switch (type)
+    {
+    case FrameType::Evaluate:
+        return !compressed() && count <= kMaxFrameValues;
+    case FrameType::EvaluateBatch:
+        return !tagged() && count > 0 && count <= kMaxBatchRows;
+    }
+    return false;
+}
+
+bool FrameHeader::tagged() const
+{
+    return (flags & kFlagTagged) != 0;
+}
+
+bool FrameHeader::batch() const
+{
+    return type == FrameType::EvaluateBatch;
+}
+
+bool FrameHeader::compressed() const
+{
+    return (flags & kFlagCompressed) != 0;
+}
+
+std::size_t FrameHeader::payload_size() const
+{
+    if (batch())
+    {
+        return kBodySizeSize;
+    }
+    return (tagged() ? kRequestIdSize : 0) + (scaled_encoding(encoding) ? kScaleSize : 0) +
+           static_cast<std::size_t>(count) * encoded_value_size(encoding);
+}
+
+MagicMatch match_binary_magic(std::string_view prefix)
+{
+    const std::size_t length = std::min(prefix.size(), kBinaryMagic.size());
+    if (!std::equal(prefix.begin(), prefix.begin() + static_cast<std::ptrdiff_t>(length), kBinaryMagic.begin()))
+    {
+        return MagicMatch::Text;
+    }
+
+    return (length == kBinaryMagic.size()) ? MagicMatch::Binary : MagicMatch::Incomplete;
+}
+
+FrameHeader decode_frame_header(const char *data)
+{
+    return FrameHeader{
+        .type = static_cast<FrameType>(static_cast<std::uint8_t>(data[0])),
+        .encoding = static_cast<Encoding>(static_cast<std::uint8_t>(data[1])),
+        .flags = load_le<std::uint16_t>(data + 2),
+        .count = load_le<std::uint32_t>(data + 4),
+    };
+}
+
+std::uint64_t decode_request_id(const char *data)
+{
+    return load_le<std::uint64_t>(data);
+}
+
+std::uint32_t decode_body_size(const char *data)
+{
+    return load_le<std::uint32_t>(data);
+}
+
+std::size_t batch_body_size(Encoding encoding, std::size_t rows, std::size_t width)
+{
+    return (scaled_encoding(encoding) ? kScaleSize : 0) + rows * width * encoded_value_size(encoding);
+}
+
+std::size_t encoded_value_size(Encoding encoding)
+{
+    switch (encoding)
+    {
+    case Encoding::Float32:
+        return sizeof(float);
+    case Encoding::Float16:
+    case Encoding::Int16:
+        return sizeof(std::uint16_t);
+    case Encoding::Int8:
+        return sizeof(std::int8_t);
+    }
+    return 0;
+}
+
+bool scaled_encoding(Encoding encoding)
+{
+    return encoding == Encoding::Int16 || encoding == Encoding::Int8;
+}
+
+void decode_values(Encoding encoding, const char *data, float scale, std::span<float> output)
+{
+    decode_with(decoders(), encoding, data, scale, output);
+}
+
+bool decode_values_with(std::string_view isa_name,
+                        Encoding encoding,
+                        const char *data,
+                        float scale,
+                        std::span<float> output)
+{
+    Decoders selected{};
+    if (!find_decoders(isa_name, selected))
+    {
+        return false;
+    }
+
+    decode_with(selected, encoding, data, scale, output);
+    return true;
+}
+
+void decode_frame_values(const FrameHeader &header, const char *data, std::span<float> output)
+{
+    float scale = 1.0f;
+    if (scaled_encoding(header.encoding))
+    {
+        scale = load_le<float>(data);
+        data += kScaleSize;
+    }
+    decode_values(header.encoding, data, scale, output);
+}
+
+void append_reply(ReplyBuffer &out, ReplyStatus status, double mse)
+{
+    char reply[kReplySize];
+    reply[0] = static_cast<char>(status);
+    store_le<double>(reply + 1, mse);
+    out.append(std::string_view(reply, kReplySize));
+}
+
+void append_tagged_reply(ReplyBuffer &out, std::uint64_t request_id, ReplyStatus status, double mse)
+{
+    char reply[kTaggedReplySize];
+    reply[0] = static_cast<char>(static_cast<std::uint8_t>(status) | kReplyTaggedBit);
+    store_le<std::uint64_t>(reply + 1, request_id);
+    store_le<double>(reply + 1 + kRequestIdSize, mse);
+    out.append(std::string_view(reply, kTaggedReplySize));
+}
+
+void append_batch_reply(ReplyBuffer &out, std::span<const DetectionResult> results, bool compressed)
+{
+    // Per-thread staging, reused by every batch the thread answers.
+    thread_local std::vector<char> body;
+    thread_local std::vector<char> packed;
+
+    body.resize(kBatchReplyHeaderSize + results.size() * kReplySize);
+    char *row = body.data() + kBatchReplyHeaderSize;
+    for (const DetectionResult &result : results)
+    {
+        row[0] = static_cast<char>(to_reply_status(result.status));
+        store_le<double>(row + 1, result.mse);
+        row += kReplySize;
+    }
+
+    std::string_view reply(body.data(), body.size());
+    char *header = body.data();
+    if (compressed)
+    {
+        const std::string_view raw = reply.substr(kBatchReplyHeaderSize);
+        packed.resize(kBatchReplyHeaderSize + lz4::compress_bound(raw.size()));
+        const std::size_t packed_size =
+            lz4::compress(raw, std::span<char>(packed).subspan(kBatchReplyHeaderSize));
+        reply = std::string_view(packed.data(), kBatchReplyHeaderSize + packed_size);
+        header = packed.data();
+    }
+
+    header[0] = static_cast<char>(kReplyBatchMarker);
+    header[1] = 0;
+    store_le<std::uint16_t>(header + 2, compressed ? kFlagCompressed : 0);
+    store_le<std::uint32_t>(header + 4, static_cast<std::uint32_t>(results.size()));
+    store_le<std::uint32_t>(header + 8, static_cast<std::uint32_t>(reply.size() - kBatchReplyHeaderSize));
+    out.append(reply);
+}
+
+ReplyStatus to_reply_status(DetectionStatus status)
+{
+    return (status == DetectionStatus::Anomaly) ? ReplyStatus::Anomaly : ReplyStatus::Ok;
+}
+} // namespace ds::wire
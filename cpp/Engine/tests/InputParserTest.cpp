@@ -0,0 +1,110 @@
+// Compares parse_input_value() with std::from_chars bit for bit. Every "%.3f"-style
+// token of up to seven digits goes through the fixed-point fast path, sampled tokens
+// cover the other fraction lengths, and tokens the fast path must hand back to
+// from_chars check that they still parse the same way.
+
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "InputParser.hpp"
+
+namespace
+{
+constexpr std::uint32_t kMaxMantissa = 10'000'000;
+constexpr int kSamplesPerFraction = 200'000;
+
+// Writes `mantissa` with `fraction_digits` of it after the decimal point, e.g.
+// (1234, 3) -> "1.234", plus `leading_zeros` extra zeros before the integer part.
+std::string fixed_point_token(bool negative, std::uint32_t mantissa, int fraction_digits, int leading_zeros)
+{
+    std::string digits = std::to_string(mantissa);
+    if (static_cast<int>(digits.size()) <= fraction_digits)
+    {
+        digits.insert(0, static_cast<std::size_t>(fraction_digits) + 1 - digits.size(), '0');
+    }
+    if (fraction_digits > 0)
+    {
+        digits.insert(digits.size() - static_cast<std::size_t>(fraction_digits), 1, '.');
+    }
+    digits.insert(0, static_cast<std::size_t>(leading_zeros), '0');
+    return negative ? "-" + digits : digits;
+}
+
+// Reports the first mismatch of `token` and returns whether it parsed like from_chars.
+bool matches_from_chars(std::string_view token)
+{
+    std::string_view reference_token = token;
+    if (reference_token.size() > 1 && reference_token.front() == '+' && reference_token[1] != '-')
+    {
+        reference_token.remove_prefix(1);
+    }
+
+    float expected = 0.0F;
+    const auto [end, ec] =
+        std::from_chars(reference_token.data(), reference_token.data() + reference_token.size(), expected);
+    const bool expected_ok =
+        ec == std::errc{} && end == reference_token.data() + reference_token.size() && std::isfinite(expected);
+
+    float actual = 0.0F;
+    const bool actual_ok = ds::parse_input_value(token, actual);
+    if (actual_ok != expected_ok || (expected_ok && std::bit_cast<std::uint32_t>(actual) !=
+                                                         std::bit_cast<std::uint32_t>(expected)))
+    {
+        std::cerr << "FAILED: \"" << token << "\" parsed as " << actual << " (" << actual_ok << "), from_chars gives "
+                  << expected << " (" << expected_ok << ")\n";
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+int main()
+{
+    bool passed = true;
+
+    // The producer's format: every value up to seven digits with three decimals.
+    bool exhaustive_passed = true;
+    for (std::uint32_t mantissa = 0; mantissa < kMaxMantissa && exhaustive_passed; ++mantissa)
+    {
+        exhaustive_passed = matches_from_chars(fixed_point_token(false, mantissa, 3, 0)) &&
+                            matches_from_chars(fixed_point_token(true, mantissa, 3, 0));
+    }
+    std::cout << (exhaustive_passed ? "PASSED: " : "FAILED: ") << "every 3-decimal token of up to 7 digits\n";
+    passed &= exhaustive_passed;
+
+    std::mt19937 random(20240601);
+    std::uniform_int_distribution<std::uint32_t> mantissas(0, kMaxMantissa - 1);
+    std::uniform_int_distribution<int> zeros(0, 2);
+    bool sampled_passed = true;
+    for (int fraction_digits = 0; fraction_digits <= 7 && sampled_passed; ++fraction_digits)
+    {
+        for (int n = 0; n < kSamplesPerFraction && sampled_passed; ++n)
+        {
+            const std::string token = fixed_point_token(n % 2 == 0, mantissas(random), fraction_digits, zeros(random));
+            sampled_passed = matches_from_chars(token);
+        }
+    }
+    std::cout << (sampled_passed ? "PASSED: " : "FAILED: ") << "sampled tokens with 0 to 7 decimals\n";
+    passed &= sampled_passed;
+
+    // Tokens outside the fast path's reach, or next to its edges.
+    bool edges_passed = true;
+    for (const std::string_view token :
+         {"0", "-0", "-0.000", "1.", "9999999", "99999.99", "10000000", "12345678", "0.12345678", "1.0000001",
+          "16777217", "1677721.7", "+2.5", "+-2.5", "+", "-", ".5", "-.5", "1e3", "1.5E-3", "-2.5e+2", "1e39",
+          "0x10", "nan", "inf", "-inf", "1.2.3", "1-2", "--1", "3.4028235e38", "1e-46"})
+    {
+        edges_passed &= matches_from_chars(token);
+    }
+    std::cout << (edges_passed ? "PASSED: " : "FAILED: ") << "tokens the fast path hands to from_chars\n";
+    passed &= edges_passed;
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
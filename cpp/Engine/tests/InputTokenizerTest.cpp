@@ -0,0 +1,127 @@
+// Forces each tokenize_lines() instruction set in turn and compares its token and line
+// spans with the scalar scan's on random buffers of every length around the 64-byte
+// block boundaries, so the SIMD classifiers and the scalar tail are all exercised.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "InputTokenizer.hpp"
+
+namespace
+{
+constexpr const char *kIsaNames[] = {"avx2", "sse4.2"};
+constexpr std::size_t kMaxLength = 4 * 64 + 1;
+constexpr int kBuffersPerLength = 200;
+
+// Mostly number characters, with every separator the tokenizer knows and a few
+// bytes that look like separators to a sloppy classifier.
+constexpr std::string_view kAlphabet = "0123456789.-e@ \t\r\v\f\n\n\n  \x0b\x1f\x7f\x80\xff";
+
+bool same_spans(const ds::TokenizedText &a, const ds::TokenizedText &b)
+{
+    if (a.consumed != b.consumed || a.tokens.size() != b.tokens.size() || a.lines.size() != b.lines.size())
+    {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < a.tokens.size(); ++i)
+    {
+        if (a.tokens[i].offset != b.tokens[i].offset || a.tokens[i].length != b.tokens[i].length)
+        {
+            return false;
+        }
+    }
+
+    for (std::size_t i = 0; i < a.lines.size(); ++i)
+    {
+        const ds::TextLine &x = a.lines[i];
+        const ds::TextLine &y = b.lines[i];
+        if (x.offset != y.offset || x.length != y.length || x.first_token != y.first_token ||
+            x.token_count != y.token_count)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string escaped(std::string_view text)
+{
+    std::string out;
+    for (const char c : text)
+    {
+        if (c >= 0x20 && c < 0x7f)
+        {
+            out += c;
+        }
+        else
+        {
+            char hex[5];
+            std::snprintf(hex, sizeof(hex), "\\x%02x", static_cast<unsigned char>(c));
+            out += hex;
+        }
+    }
+    return out;
+}
+} // namespace
+
+int main()
+{
+    std::mt19937 random(20240601);
+    std::uniform_int_distribution<std::size_t> pick(0, kAlphabet.size() - 1);
+
+    ds::TokenizedText expected;
+    ds::TokenizedText actual;
+    bool passed = true;
+
+    for (const char *isa : kIsaNames)
+    {
+        if (!ds::tokenize_lines_with(isa, "", actual))
+        {
+            std::cout << "SKIPPED: " << isa << " (not supported by this CPU)\n";
+            continue;
+        }
+
+        bool isa_passed = true;
+        for (std::size_t length = 0; length <= kMaxLength && isa_passed; ++length)
+        {
+            for (int n = 0; n < kBuffersPerLength; ++n)
+            {
+                std::string text(length, ' ');
+                for (char &c : text)
+                {
+                    c = kAlphabet[pick(random)];
+                }
+
+                ds::tokenize_lines_with("scalar", text, expected);
+                ds::tokenize_lines_with(isa, text, actual);
+                if (!same_spans(expected, actual))
+                {
+                    std::cerr << "FAILED: " << isa << " differs from scalar on \"" << escaped(text) << "\"\n";
+                    isa_passed = false;
+                    break;
+                }
+            }
+        }
+
+        std::cout << (isa_passed ? "PASSED: " : "FAILED: ") << isa << " matches scalar\n";
+        passed &= isa_passed;
+    }
+
+    // The runtime selection must be one of the paths checked above.
+    ds::tokenize_lines("1 2\n3", expected);
+    ds::tokenize_lines_with(ds::tokenizer_isa_name(), "1 2\n3", actual);
+    if (!same_spans(expected, actual) || expected.lines.size() != 1 || expected.tokens.size() != 2 ||
+        expected.consumed != 4)
+    {
+        std::cerr << "FAILED: runtime selection " << ds::tokenizer_isa_name() << '\n';
+        passed = false;
+    }
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
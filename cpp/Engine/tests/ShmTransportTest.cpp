@@ -0,0 +1,247 @@
+// Runs ShmServer with a stub backend in this process and drives it with ShmClient from
+// forked children, so every request, reply and channel handover crosses a real process
+// boundary.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AnomalyDetector.hpp"
+#include "IInferenceBackend.hpp"
+#include "ShmClient.hpp"
+#include "ShmServer.hpp"
+
+namespace
+{
+constexpr std::size_t kInputSize = 8;
+constexpr double kThreshold = 1.0;
+
+// Reconstructs every input as zeros, so a request's MSE is the mean of its squares.
+class StubBackend : public ds::IInferenceBackend
+{
+public:
+    std::string backend_name() const override
+    {
+        return "stub";
+    }
+
+    std::size_t expected_input_size() const override
+    {
+        return kInputSize;
+    }
+
+    std::vector<float> reconstruct(const std::vector<float> &input) override
+    {
+        return std::vector<float>(input.size(), 0.0F);
+    }
+};
+
+void expect(bool condition, const std::string &what)
+{
+    if (!condition)
+    {
+        std::cerr << "FAILED: " << what << '\n';
+        std::_Exit(EXIT_FAILURE);
+    }
+}
+
+// Runs `body` in a forked child and reports whether it exited cleanly.
+bool run_child(const std::string &name, const std::function<void()> &body)
+{
+    // Otherwise the child flushes the parent's buffered output a second time.
+    std::cout.flush();
+    const pid_t pid = ::fork();
+    if (pid < 0)
+    {
+        throw std::runtime_error("fork failed");
+    }
+
+    if (pid == 0)
+    {
+        try
+        {
+            body();
+        }
+        catch (const std::exception &ex)
+        {
+            std::cerr << "FAILED: " << name << ": " << ex.what() << '\n';
+            std::_Exit(EXIT_FAILURE);
+        }
+        std::exit(EXIT_SUCCESS);
+    }
+
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    const bool passed = WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+    std::cout << (passed ? "PASSED: " : "FAILED: ") << name << '\n';
+    return passed;
+}
+
+// Claims every channel of the region, retrying while the server has yet to recycle
+// channels that earlier clients gave up.
+std::vector<std::unique_ptr<ds::ShmClient>> claim_all_channels(const std::string &region)
+{
+    std::vector<std::unique_ptr<ds::ShmClient>> clients;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (clients.size() < ds::shm::kMaxChannels)
+    {
+        try
+        {
+            clients.push_back(std::make_unique<ds::ShmClient>(region));
+        }
+        catch (const std::runtime_error &)
+        {
+            expect(std::chrono::steady_clock::now() < deadline, "channels are recycled within 5 s");
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    return clients;
+}
+
+void round_trips(const std::string &region)
+{
+    ds::ShmClient client(region);
+    expect(client.expected_input_size() == kInputSize, "region publishes the expected input size");
+
+    const std::vector<float> normal(kInputSize, 0.1F);
+    const std::vector<float> anomalous(kInputSize, 3.0F);
+    const std::vector<float> short_input(kInputSize / 2, 0.1F);
+
+    const ds::ShmReply ok = client.evaluate(normal);
+    expect(ok.status == ds::wire::ReplyStatus::Ok, "normal input is OK");
+    expect(ok.mse > 0.0099 && ok.mse < 0.0101, "normal input MSE is 0.01");
+    expect(client.evaluate(anomalous).status == ds::wire::ReplyStatus::Anomaly, "anomalous input is an anomaly");
+    expect(client.evaluate(short_input).status == ds::wire::ReplyStatus::Error, "short input is an error");
+
+    // More requests than the ring holds, pipelined; replies come back in order.
+    constexpr std::uint64_t kRequests = ds::shm::kRingCapacity * 4;
+    std::uint64_t sent = 0;
+    std::uint64_t received = 0;
+    ds::ShmReply reply{};
+    while (received < kRequests)
+    {
+        while (sent < kRequests && client.try_submit(sent, sent % 2 == 0 ? normal : anomalous))
+        {
+            ++sent;
+        }
+        while (client.try_receive(reply))
+        {
+            expect(reply.request_id == received, "pipelined replies arrive in order");
+            expect(reply.status ==
+                       (received % 2 == 0 ? ds::wire::ReplyStatus::Ok : ds::wire::ReplyStatus::Anomaly),
+                   "pipelined reply status matches its request");
+            ++received;
+        }
+    }
+}
+
+void exhaust_and_release(const std::string &region)
+{
+    auto clients = claim_all_channels(region);
+
+    bool refused = false;
+    try
+    {
+        ds::ShmClient extra(region);
+    }
+    catch (const std::runtime_error &)
+    {
+        refused = true;
+    }
+    expect(refused, "a client beyond the channel count is refused");
+
+    const std::vector<float> normal(kInputSize, 0.1F);
+    for (auto &client : clients)
+    {
+        expect(client->evaluate(normal).status == ds::wire::ReplyStatus::Ok, "every channel serves requests");
+    }
+    // The clients release their channels on the way out.
+}
+
+void exhaust_and_crash(const std::string &region)
+{
+    auto clients = claim_all_channels(region);
+    const std::vector<float> normal(kInputSize, 0.1F);
+    clients.front()->try_submit(0, normal);
+    // Exits without running a destructor, leaving every channel Active under a dead pid.
+    std::_Exit(EXIT_SUCCESS);
+}
+
+// Takes the pid of every channel the way ShmClient starts a claim, then exits before
+// setting any state, as if the process died between the two steps.
+void die_mid_claim(const std::string &region)
+{
+    const int fd = ::shm_open(region.c_str(), O_RDWR, 0);
+    expect(fd >= 0, "the region opens");
+    void *mapping = ::mmap(nullptr, sizeof(ds::shm::Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    expect(mapping != MAP_FAILED, "the region maps");
+
+    auto *shared = static_cast<ds::shm::Region *>(mapping);
+    std::size_t taken = 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (taken < ds::shm::kMaxChannels)
+    {
+        for (auto &channel : shared->channels)
+        {
+            std::int32_t unowned = 0;
+            if (channel.owner_pid.compare_exchange_strong(unowned, static_cast<std::int32_t>(::getpid())))
+            {
+                ++taken;
+            }
+        }
+        expect(std::chrono::steady_clock::now() < deadline, "channels are recycled within 5 s");
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::_Exit(EXIT_SUCCESS);
+}
+
+void reclaim(const std::string &region)
+{
+    auto clients = claim_all_channels(region);
+    const std::vector<float> normal(kInputSize, 0.1F);
+    expect(clients.back()->evaluate(normal).status == ds::wire::ReplyStatus::Ok,
+           "a reclaimed channel serves requests");
+}
+} // namespace
+
+int main()
+{
+    try
+    {
+        const std::string region = "/ds_shm_test_" + std::to_string(::getpid());
+
+        StubBackend backend;
+        ds::AnomalyDetector detector(backend, kThreshold);
+        ds::ShmServer server(region, detector, kInputSize, std::chrono::microseconds(50));
+        server.start();
+
+        bool passed = true;
+        passed &= run_child("round trips", [&] { round_trips(region); });
+        passed &= run_child("channels released on exit", [&] { exhaust_and_release(region); });
+        passed &= run_child("released channels recycled", [&] { reclaim(region); });
+        passed &= run_child("client exits without releasing", [&] { exhaust_and_crash(region); });
+        passed &= run_child("abandoned channels reclaimed", [&] { reclaim(region); });
+        passed &= run_child("client exits partway through a claim", [&] { die_mid_claim(region); });
+        passed &= run_child("half-claimed channels reclaimed", [&] { reclaim(region); });
+
+        return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << "Fatal error: " << ex.what() << '\n';
+        return EXIT_FAILURE;
+    }
+}
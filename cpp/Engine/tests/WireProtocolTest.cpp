@@ -0,0 +1,159 @@
+// Forces each decode_values() instruction set in turn and compares it with the scalar
+// kernels bit for bit: every binary16 value, every int16 and int8 value under a range of
+// scales, and random buffers of every length around the 8-value vector width, read from
+// and written to unaligned addresses so the scalar tails run too.
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "WireProtocol.hpp"
+
+namespace
+{
+using ds::wire::Encoding;
+
+constexpr const char *kIsaNames[] = {"avx2", "f16c"};
+constexpr float kScales[] = {1.0f, 0.5f, 1.0f / 3.0f, 1e-3f, -2.5f, 0x1p-140f, 1e35f};
+constexpr std::size_t kMaxLength = 4 * 8 + 1;
+constexpr std::size_t kMaxOffset = 7;
+
+const char *encoding_name(Encoding encoding)
+{
+    switch (encoding)
+    {
+    case Encoding::Float32:
+        return "float32";
+    case Encoding::Float16:
+        return "float16";
+    case Encoding::Int16:
+        return "int16";
+    case Encoding::Int8:
+        return "int8";
+    }
+    return "unknown";
+}
+
+// Decodes `count` values of `packed` with `isa` and with the scalar kernels and
+// reports the first value whose bits differ.
+bool matches_scalar(std::string_view isa,
+                    Encoding encoding,
+                    std::span<const char> packed,
+                    float scale,
+                    std::size_t count,
+                    std::size_t output_offset)
+{
+    std::vector<float> expected(count);
+    std::vector<float> actual(count + output_offset);
+    const std::span<float> output = std::span<float>(actual).subspan(output_offset);
+
+    ds::wire::decode_values_with("scalar", encoding, packed.data(), scale, expected);
+    ds::wire::decode_values_with(isa, encoding, packed.data(), scale, output);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (std::bit_cast<std::uint32_t>(expected[i]) != std::bit_cast<std::uint32_t>(output[i]))
+        {
+            std::cerr << "FAILED: " << isa << ' ' << encoding_name(encoding) << " value " << i << " of " << count
+                      << " (scale " << scale << ") decodes to 0x" << std::hex
+                      << std::bit_cast<std::uint32_t>(output[i]) << ", scalar gives 0x"
+                      << std::bit_cast<std::uint32_t>(expected[i]) << std::dec << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+// Little-endian bytes of every 16-bit pattern, in order.
+std::vector<char> every_16_bit_value()
+{
+    std::vector<char> packed(65536 * 2);
+    for (std::uint32_t value = 0; value < 65536; ++value)
+    {
+        packed[value * 2] = static_cast<char>(value & 0xffu);
+        packed[value * 2 + 1] = static_cast<char>(value >> 8);
+    }
+    return packed;
+}
+
+std::vector<char> every_8_bit_value()
+{
+    std::vector<char> packed(256);
+    for (std::uint32_t value = 0; value < 256; ++value)
+    {
+        packed[value] = static_cast<char>(value);
+    }
+    return packed;
+}
+
+bool check_isa(std::string_view isa, std::mt19937 &random)
+{
+    bool passed = true;
+
+    const std::vector<char> halves = every_16_bit_value();
+    passed &= matches_scalar(isa, Encoding::Float16, halves, 1.0f, 65536, 0);
+
+    const std::vector<char> bytes = every_8_bit_value();
+    for (const float scale : kScales)
+    {
+        passed &= matches_scalar(isa, Encoding::Int16, halves, scale, 65536, 0);
+        passed &= matches_scalar(isa, Encoding::Int8, bytes, scale, 256, 0);
+    }
+
+    // Every length around the vector width at every input and output misalignment.
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<char> buffer(kMaxOffset + kMaxLength * sizeof(float));
+    for (const Encoding encoding : {Encoding::Float32, Encoding::Float16, Encoding::Int16, Encoding::Int8})
+    {
+        for (std::size_t length = 0; length <= kMaxLength && passed; ++length)
+        {
+            for (std::size_t offset = 0; offset <= kMaxOffset && passed; ++offset)
+            {
+                for (char &c : buffer)
+                {
+                    c = static_cast<char>(byte(random));
+                }
+                const auto packed = std::span<const char>(buffer).subspan(offset);
+                passed &= matches_scalar(isa, encoding, packed, 0.25f, length, offset % 4);
+            }
+        }
+    }
+    return passed;
+}
+} // namespace
+
+int main()
+{
+    std::mt19937 random(20240601);
+    bool passed = true;
+
+    for (const char *isa : kIsaNames)
+    {
+        float probe = 0.0f;
+        if (!ds::wire::decode_values_with(isa, Encoding::Float16, "\0\0", 1.0f, std::span<float>(&probe, 1)))
+        {
+            std::cout << "SKIPPED: " << isa << " (not supported by this CPU)\n";
+            continue;
+        }
+
+        const bool isa_passed = check_isa(isa, random);
+        std::cout << (isa_passed ? "PASSED: " : "FAILED: ") << isa << " decoders match scalar\n";
+        passed &= isa_passed;
+    }
+
+    // The scalar kernels themselves, on values with a known float32 image.
+    const char known[] = {0x00, 0x3c, 0x00, static_cast<char>(0xc0), 0x01, 0x00, 0x00, 0x7c};
+    float decoded[4] = {};
+    ds::wire::decode_values_with("scalar", Encoding::Float16, known, 1.0f, decoded);
+    const bool scalar_passed =
+        decoded[0] == 1.0f && decoded[1] == -2.0f && decoded[2] == 0x1p-24f && std::isinf(decoded[3]);
+    std::cout << (scalar_passed ? "PASSED: " : "FAILED: ") << "scalar binary16 reference values\n";
+    passed &= scalar_passed;
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,6 +1,7 @@
 import os
 import random
 import socket
+import struct
 import sys
 import time
 from pathlib import Path
@@ -9,6 +10,30 @@ HOST = os.getenv("ENGINE_HOST", "127.0.0.1")
 PORT = int(os.getenv("ENGINE_PORT", "9000"))
 PROTOCOL = os.getenv("DATASENTINEL_PROTOCOL", "tcp").strip().lower()
 TARGET = f"{HOST}:{PORT}"
+# Optional AF_UNIX socket path; when set, TCP mode connects there instead of HOST:PORT.
+UNIX_SOCKET = os.getenv("ENGINE_UNIX_SOCKET", "").strip()
+# TCP payload encoding: "text" (space separated line) or "binary" (length-prefixed float32 frames).
+TCP_ENCODING = os.getenv("DATASENTINEL_TCP_ENCODING", "text").strip().lower()
+# Samples per TCP message; above 1 they go out as one "BATCH <n>" block or binary batch frame.
+TCP_BATCH = int(os.getenv("DATASENTINEL_TCP_BATCH", "1"))
+# Binary batch frame compression: "none" or "lz4" (needs an engine built with DS_ENABLE_LZ4).
+TCP_COMPRESSION = os.getenv("DATASENTINEL_TCP_COMPRESSION", "none").strip().lower()
+# Value encoding for binary TCP frames and gRPC: float32, float16, int16 or int8 (scaled).
+VALUE_ENCODING = os.getenv("DATASENTINEL_VALUE_ENCODING", "float32").strip().lower()
+# gRPC call style: "unary" (one Evaluate call per sample), "stream" (one long-lived EvaluateStream)
+# or "batch" (EvaluateBatch calls of DATASENTINEL_GRPC_BATCH samples).
+GRPC_CALL = os.getenv("DATASENTINEL_GRPC_CALL", "unary").strip().lower()
+GRPC_BATCH = int(os.getenv("DATASENTINEL_GRPC_BATCH", "1000"))
+
+# Binary framing constants (must match cpp/Engine/include/WireProtocol.hpp).
+BINARY_MAGIC = b"DSB1"
+FRAME_TYPE_EVALUATE = 1
+FRAME_TYPE_EVALUATE_BATCH = 2
+FLAG_COMPRESSED = 0x0002
+VALUE_ENCODINGS = {"float32": 0, "float16": 1, "int16": 2, "int8": 3}
+REPLY_SIZE = 9
+BATCH_REPLY_HEADER_SIZE = 12
+REPLY_STATUS_NAMES = {0: "OK", 1: "ANOMALY", 2: "ERROR"}
 
 # Model expects 8 float values
 EXPECTED_INPUT_SIZE = 8
@@ -66,47 +91,249 @@ def next_payload(message_count):
     return data, message_count + 1
 
 
+def recv_exact(sock, size):
+    data = b""
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            raise ConnectionResetError("Engine closed the connection")
+        data += chunk
+    return data
+
+
+def negotiate_binary(sock):
+    sock.sendall(BINARY_MAGIC)
+    if recv_exact(sock, len(BINARY_MAGIC)) != BINARY_MAGIC:
+        raise ConnectionError("Engine did not accept binary framing")
+
+
+def quantize(data, limit):
+    scale = max(abs(value) for value in data) / limit or 1.0
+    return scale, [round(value / scale) for value in data]
+
+
+def pack_values(data):
+    """Returns data packed little-endian in VALUE_ENCODING and the scale to decode it with."""
+    count = len(data)
+    if VALUE_ENCODING == "float16":
+        return struct.pack(f"<{count}e", *data), 1.0
+    if VALUE_ENCODING == "int16":
+        scale, quantized = quantize(data, 32767)
+        return struct.pack(f"<{count}h", *quantized), scale
+    if VALUE_ENCODING == "int8":
+        scale, quantized = quantize(data, 127)
+        return struct.pack(f"<{count}b", *quantized), scale
+    return struct.pack(f"<{count}f", *data), 1.0
+
+
+def exchange_binary(sock, data):
+    packed, scale = pack_values(data)
+    header = struct.pack("<BBHI", FRAME_TYPE_EVALUATE, VALUE_ENCODINGS[VALUE_ENCODING], 0, len(data))
+    if VALUE_ENCODING in ("int16", "int8"):
+        header += struct.pack("<f", scale)
+    sock.sendall(header + packed)
+    status, mse = struct.unpack("<Bd", recv_exact(sock, REPLY_SIZE))
+    return format_binary_reply(status, mse)
+
+
+def format_binary_reply(status, mse):
+    return f"{REPLY_STATUS_NAMES.get(status, 'UNKNOWN')} (mse={mse:.6f})"
+
+
+def exchange_binary_batch(sock, rows):
+    packed, scale = pack_values([value for data in rows for value in data])
+    body = (struct.pack("<f", scale) if VALUE_ENCODING in ("int16", "int8") else b"") + packed
+    flags = 0
+    if TCP_COMPRESSION == "lz4":
+        import lz4.block
+
+        body = lz4.block.compress(body, store_size=False)
+        flags |= FLAG_COMPRESSED
+
+    header = struct.pack(
+        "<BBHII", FRAME_TYPE_EVALUATE_BATCH, VALUE_ENCODINGS[VALUE_ENCODING], flags, len(rows), len(body)
+    )
+    sock.sendall(header + body)
+
+    _, _, reply_flags, count, body_size = struct.unpack("<BBHII", recv_exact(sock, BATCH_REPLY_HEADER_SIZE))
+    body = recv_exact(sock, body_size)
+    if reply_flags & FLAG_COMPRESSED:
+        body = lz4.block.decompress(body, uncompressed_size=count * REPLY_SIZE)
+    return ", ".join(format_binary_reply(*struct.unpack_from("<Bd", body, i * REPLY_SIZE)) for i in range(count))
+
+
+def format_text_line(data):
+    return " ".join(f"{value:.3f}" for value in data) + "\n"
+
+
+def exchange_text(sock, data):
+    sock.sendall(format_text_line(data).encode())
+    response = sock.recv(4096)
+    if not response:
+        raise ConnectionResetError("Engine closed the connection")
+    return response.decode().strip()
+
+
+def recv_lines(sock, count):
+    data = b""
+    while data.count(b"\n") < count:
+        chunk = sock.recv(4096)
+        if not chunk:
+            raise ConnectionResetError("Engine closed the connection")
+        data += chunk
+    return data.decode().splitlines()
+
+
+def exchange_text_batch(sock, rows):
+    message = f"BATCH {len(rows)}\n" + "".join(format_text_line(data) for data in rows)
+    sock.sendall(message.encode())
+    # The reply block repeats the header, then holds one reply line per row.
+    lines = recv_lines(sock, len(rows) + 1)
+    return ", ".join(lines[1:])
+
+
 def run_tcp():
+    if TCP_ENCODING not in ("text", "binary"):
+        raise ValueError(f"Unsupported DATASENTINEL_TCP_ENCODING={TCP_ENCODING}. Supported values: text, binary")
+    if TCP_BATCH < 1:
+        raise ValueError(f"Unsupported DATASENTINEL_TCP_BATCH={TCP_BATCH}. Supported values: n >= 1")
+    if TCP_COMPRESSION not in ("none", "lz4") or (
+        TCP_COMPRESSION == "lz4" and (TCP_ENCODING != "binary" or TCP_BATCH == 1)
+    ):
+        raise ValueError(
+            f"Unsupported DATASENTINEL_TCP_COMPRESSION={TCP_COMPRESSION}. Supported values: none, lz4 (binary batches)"
+        )
+
     message_count = 0
     sock = None
-    print(f"[Producer] Protocol: tcp, target: {TARGET}")
+    # A draining engine closes between requests; one it never answered was never
+    # scored, so it is sent again on the next connection.
+    unanswered = None
+    target = f"unix:{UNIX_SOCKET}" if UNIX_SOCKET else TARGET
+    print(f"[Producer] Protocol: tcp ({TCP_ENCODING}), target: {target}")
 
     while True:
         try:
             if sock is None:
-                sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
-                sock.connect((HOST, PORT))
+                if UNIX_SOCKET:
+                    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+                    sock.connect(UNIX_SOCKET)
+                else:
+                    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+                    sock.connect((HOST, PORT))
+                if TCP_ENCODING == "binary":
+                    negotiate_binary(sock)
                 print("[Producer] Connected to Engine.")
 
-            data, message_count = next_payload(message_count)
-            message = " ".join(f"{value:.3f}" for value in data) + "\n"
-            sock.sendall(message.encode())
+            if unanswered is None:
+                if TCP_BATCH > 1:
+                    unanswered = []
+                    while len(unanswered) < TCP_BATCH:
+                        data, message_count = next_payload(message_count)
+                        # Binary batch rows share one width, so wrong-sized samples are left out.
+                        if TCP_ENCODING == "text" or len(data) == EXPECTED_INPUT_SIZE:
+                            unanswered.append(data)
+                else:
+                    unanswered, message_count = next_payload(message_count)
+
+            if TCP_BATCH > 1:
+                if TCP_ENCODING == "binary":
+                    response = exchange_binary_batch(sock, unanswered)
+                else:
+                    response = exchange_text_batch(sock, unanswered)
+            elif TCP_ENCODING == "binary":
+                response = exchange_binary(sock, unanswered)
+            else:
+                response = exchange_text(sock, unanswered)
+            unanswered = None
 
-            response = sock.recv(4096)
-            print("[Producer] Received:", response.decode().strip())
+            print("[Producer] Received:", response)
             time.sleep(1)
 
-        except ConnectionRefusedError:
+        except (ConnectionRefusedError, FileNotFoundError):
             print("[Producer] Engine not running. Retrying in 3 seconds...")
             if sock is not None:
                 sock.close()
                 sock = None
             time.sleep(3)
 
-        except ConnectionResetError:
+        except (ConnectionResetError, BrokenPipeError):
+            # Reconnect right away: after a listener handoff the new engine is already
+            # accepting, and a refused connect falls back to the retry delay above.
             print("[Producer] Connection lost. Reconnecting...")
             if sock is not None:
                 sock.close()
                 sock = None
-            time.sleep(1)
 
         except Exception as e:
             print("[Producer] Error:", e)
             if sock is not None:
                 sock.close()
                 sock = None
+            unanswered = None
+            time.sleep(1)
+
+
+def grpc_request(inference_pb2, data, request_id=0):
+    if VALUE_ENCODING == "float32":
+        return inference_pb2.EvaluateRequest(values=data, request_id=request_id)
+    packed, scale = pack_values(data)
+    return inference_pb2.EvaluateRequest(
+        encoding=VALUE_ENCODINGS[VALUE_ENCODING], packed_values=packed, scale=scale, request_id=request_id
+    )
+
+
+def print_grpc_response(inference_pb2, response, prefix="Received"):
+    status_name = inference_pb2.EvaluateResponse.Status.Name(response.status)
+    if response.status == inference_pb2.EvaluateResponse.ERROR:
+        print(f"[Producer] {prefix} ERROR: {response.message}")
+    else:
+        print(f"[Producer] {prefix}: status={status_name}, mse={response.mse:.6f}, message={response.message}")
+
+
+def evaluate_grpc_batch(stub, inference_pb2, message_count):
+    """Sends one EvaluateBatch call; returns the updated message count."""
+    rows = []
+    while len(rows) < GRPC_BATCH:
+        data, message_count = next_payload(message_count)
+        # Batch rows share one width, so wrong-sized samples are left out.
+        if len(data) == EXPECTED_INPUT_SIZE:
+            rows.append(data)
+
+    values = [value for data in rows for value in data]
+    if VALUE_ENCODING == "float32":
+        request = inference_pb2.EvaluateBatchRequest(rows=len(rows), values=values)
+    else:
+        packed, scale = pack_values(values)
+        request = inference_pb2.EvaluateBatchRequest(
+            rows=len(rows), encoding=VALUE_ENCODINGS[VALUE_ENCODING], packed_values=packed, scale=scale
+        )
+
+    response = stub.EvaluateBatch(request, timeout=5.0)
+    if response.status == inference_pb2.EvaluateResponse.ERROR:
+        print(f"[Producer] Received ERROR: {response.message}")
+    else:
+        anomalies = sum(1 for status in response.statuses if status == inference_pb2.EvaluateResponse.ANOMALY)
+        print(f"[Producer] Received: {len(response.statuses)} rows, {anomalies} anomalies, max mse={max(response.mse):.6f}")
+    return message_count
+
+
+def stream_grpc(stub, inference_pb2, message_count):
+    """Sends samples on one EvaluateStream until it breaks; returns the updated message count."""
+    state = {"count": message_count}
+
+    def requests():
+        request_id = 0
+        while True:
+            data, state["count"] = next_payload(state["count"])
+            request_id += 1
+            yield grpc_request(inference_pb2, data, request_id)
             time.sleep(1)
 
+    for response in stub.EvaluateStream(requests()):
+        print_grpc_response(inference_pb2, response, f"Received #{response.request_id}")
+    return state["count"]
+
 
 def run_grpc():
     import grpc
@@ -121,7 +348,7 @@ def run_grpc():
     message_count = 0
     channel = None
     stub = None
-    print(f"[Producer] Protocol: grpc, target: {TARGET}")
+    print(f"[Producer] Protocol: grpc ({GRPC_CALL}), target: {TARGET}")
 
     while True:
         try:
@@ -131,17 +358,16 @@ def run_grpc():
                 stub = inference_pb2_grpc.InferenceServiceStub(channel)
                 print(f"[Producer] Connected to Engine gRPC at {TARGET}.")
 
-            data, message_count = next_payload(message_count)
-            request = inference_pb2.EvaluateRequest(values=data)
-            response = stub.Evaluate(request, timeout=5.0)
-            status_name = inference_pb2.EvaluateResponse.Status.Name(response.status)
+            if GRPC_CALL == "stream":
+                message_count = stream_grpc(stub, inference_pb2, message_count)
+                continue
 
-            if response.status == inference_pb2.EvaluateResponse.ERROR:
-                print(f"[Producer] Received ERROR: {response.message}")
+            if GRPC_CALL == "batch":
+                message_count = evaluate_grpc_batch(stub, inference_pb2, message_count)
             else:
-                print(
-                    f"[Producer] Received: status={status_name}, mse={response.mse:.6f}, message={response.message}"
-                )
+                data, message_count = next_payload(message_count)
+                response = stub.Evaluate(grpc_request(inference_pb2, data), timeout=5.0)
+                print_grpc_response(inference_pb2, response)
 
             time.sleep(1)
 
@@ -171,6 +397,16 @@ def run_grpc():
 
 
 def main():
+    if VALUE_ENCODING not in VALUE_ENCODINGS:
+        raise ValueError(
+            f"Unsupported DATASENTINEL_VALUE_ENCODING={VALUE_ENCODING}. Supported values: {', '.join(VALUE_ENCODINGS)}"
+        )
+
+    if GRPC_CALL not in ("unary", "stream", "batch"):
+        raise ValueError(f"Unsupported DATASENTINEL_GRPC_CALL={GRPC_CALL}. Supported values: unary, stream, batch")
+    if not 1 <= GRPC_BATCH <= 4096:
+        raise ValueError(f"Unsupported DATASENTINEL_GRPC_BATCH={GRPC_BATCH}. Supported values: 1 to 4096")
+
     if PROTOCOL == "tcp":
         run_tcp()
         return